@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "adaptive_maximization.h"
+#include "profiler.h"
 #include "utilities.h"
 
 using std::cout;
@@ -19,27 +20,42 @@ using std::set;
 using std::string;
 using std::vector;
 
-bool ReducedMean(const EvaluationOracle& oracle, const set<int>& S,
-    vector<int> A, double tau, int t, double epsilon, double delta,
-    MaximizationResult& result) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+namespace {
+
+// Temporaries of ThresholdSampling, owned by one run of the threshold ladder
+// so that every round of every guess reuses their capacity instead of
+// allocating them again.
+struct ThresholdScratch {
+  vector<int> filtered;  // Remaining elements above the threshold
+  vector<int> sample;  // Shuffled copy of the remaining elements
+  vector<double> gains;
+  vector<char> above;
+};
+
+}  // namespace
+
+// S is extended by each sample in place and restored before returning.
+bool ReducedMean(const EvaluationOracle& oracle, set<int>& S,
+    const vector<int>& A, vector<int>& sample, double tau, int t,
+    double epsilon, double delta, MaximizationResult& result) {
+  PROFILE_SCOPE("ReducedMean");
+  std::mt19937 rng; rng.seed(RandomSeed());
   int m = 16 * ceil(log(2 / delta) / pow(epsilon, 2));
   m = min(m, 100);  // Reduce sample complexity
   assert(m > 0);
   assert(t > 0); assert(A.size() >= t);
   int num_above_threshold = 0;
-  set<int> T;
-  for (auto u : S) T.insert(u);
+  sample.assign(A.begin(), A.end());
   for (int i = 0; i < m; i++) {
-    shuffle(A.begin(), A.end(), rng);
+    shuffle(sample.begin(), sample.end(), rng);
     for (int j = 0; j < t - 1; j++) {
-      assert(!S.count(A[j]));  // T is expected to be disjoint from S.
-      T.insert(A[j]);
+      assert(!S.count(sample[j]));  // T is expected to be disjoint from S.
+      S.insert(sample[j]);
     }
-    int x = A[t - 1];
-    double gain = oracle.MarginalValue(x, T);
-    if (gain >= tau) num_above_threshold++;
-    for (int j = 0; j < t - 1; j++) T.erase(A[j]);
+    int x = sample[t - 1];
+    double gain = oracle.MarginalValue(x, S);
+    if (oracle.MarginalAtLeast(gain, tau, x, S)) num_above_threshold++;
+    for (int j = 0; j < t - 1; j++) S.erase(sample[j]);
   }
   double mu_hat = (double)num_above_threshold / m;
   // Assumes that result was increment for the new round.
@@ -48,52 +64,70 @@ bool ReducedMean(const EvaluationOracle& oracle, const set<int>& S,
   return false;
 }
 
-pair<set<int>, set<int>> ThresholdSampling(
+// Returns the elements added to old_S. A is the sorted ground set on entry
+// and the elements that remain on return. If singletons is not null, it
+// holds f({u}) for all u, which are the marginals of the first filter when
+// old_S is empty; A may then leave out elements that cannot pass it.
+set<int> ThresholdSampling(
     const EvaluationOracle& oracle, const set<int>& old_S,
     int k, double tau, double epsilon, double delta, double c3,
-    MaximizationResult& result, bool debug) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+    MaximizationResult& result, bool debug, const Budget& budget,
+    vector<int>& A, ThresholdScratch& scratch,
+    const vector<double>* singletons=nullptr) {
+  assert(singletons == nullptr || old_S.empty());
+  std::mt19937 rng; rng.seed(RandomSeed());
   double hat_epsilon = epsilon / 3;
   int n = oracle.num_nodes() - old_S.size();  // Oracle relative to S
   int r = ceil(log(2 * n / delta) / (-log(1 - hat_epsilon)));
   int m = ceil(log(k) * (1/hat_epsilon + 0.5));  // Tighter upper bound
   double hat_delta = delta / (2 * r * (m + 1));
-  set<int> A;  // New ground set relative to S
-  for (int u = 0; u < oracle.num_nodes(); u++) {
-    if (!old_S.count(u)) A.insert(u);
-  }
   set<int> S, S_for_queries;
   for (auto u : old_S) S_for_queries.insert(u);
+  vector<int>& filtered_A = scratch.filtered;
   for (int round = 0; round < r; round++) {
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
     // Update maximization result
-    result.num_rounds++;
-    result.elements_added.push_back(set<int>());
-    result.marginal_gains.push_back(0);
-    result.function_values.push_back(result.function_values.back());
-    result.num_queries.push_back(result.num_queries.back());
+    result.AddRound();
     if (n < c3 * k) break;
     // Filter remaining elements
-    vector<int> filtered_A;
-    result.num_queries[result.num_rounds] += A.size();
-    for (auto u : A) {
-      if (oracle.MarginalValue(u, S_for_queries) >= tau) {
-        filtered_A.push_back(u);
+    filtered_A.clear();
+    {
+      PROFILE_SCOPE("ThresholdSampling/filter");
+      if (round == 0 && singletons != nullptr) {
+        // Counted as the filter of the whole ground set that a guess makes
+        // on its own.
+        result.num_queries[result.num_rounds] += n;
+        scratch.gains.resize(A.size());
+        for (int i = 0; i < (int)A.size(); i++) {
+          scratch.gains[i] = (*singletons)[A[i]];
+        }
+      } else {
+        result.num_queries[result.num_rounds] += A.size();
+        oracle.MarginalValues(A, S_for_queries, scratch.gains);
+      }
+      oracle.MarginalsAtLeast(A, S_for_queries, scratch.gains, tau,
+                              scratch.above);
+      for (int i = 0; i < (int)A.size(); i++) {
+        if (scratch.above[i]) filtered_A.push_back(A[i]);
       }
     }
+    result.UpdateRoundStats();
     if (debug) {
       cout << "round: " << round << "\t";
       cout << "candidates: " << filtered_A.size() << endl;
     }
-    A.clear();
-    for (auto u : filtered_A) A.insert(u);
+    A.swap(filtered_A);  // Both stay sorted.
     if (A.size() == 0 || A.size() < c3 * k) break;
     std::map<int, bool> values_of_t;
     int t_star = -1, t = 0;
     for (int i = 0; i <= m; i++) {
       t = min((int)ceil(pow(1 + hat_epsilon, i)), (int)A.size());
       if (values_of_t.count(t)) continue;
-      bool estimate = ReducedMean(oracle, S_for_queries, filtered_A, tau, t,
-          hat_epsilon, hat_delta, result);
+      bool estimate = ReducedMean(oracle, S_for_queries, A, scratch.sample,
+          tau, t, hat_epsilon, hat_delta, result);
       values_of_t[t] = estimate;
       if (!estimate) {
         t_star = t;
@@ -102,17 +136,24 @@ pair<set<int>, set<int>> ThresholdSampling(
     t = t_star;
     assert(t >= 1);
     t = min(t, k - (int)S.size());
-    shuffle(filtered_A.begin(), filtered_A.end(), rng);
+    vector<int>& shuffled_A = scratch.sample;
+    shuffled_A.assign(A.begin(), A.end());
+    shuffle(shuffled_A.begin(), shuffled_A.end(), rng);
     if (debug) {
       cout << "subset size: " << t << "\t" << "|S|: " << S.size() + t << endl;
     }
     // Update the state of the algorithm and the result struct.
     set<int> T;
-    for (int i = 0; i < t; i++) T.insert(filtered_A[i]);
-    result.elements_added[result.num_rounds] = T;
-    double gain = oracle.MarginalValue(T, S_for_queries);
+    for (int i = 0; i < t; i++) T.insert(shuffled_A[i]);
+    result.SetElementsAdded(T);
+    double gain;
+    {
+      PROFILE_SCOPE("ThresholdSampling/gain");
+      gain = oracle.MarginalValue(T, S_for_queries);
+    }
     result.marginal_gains[result.num_rounds] = gain;
     result.function_values[result.num_rounds] += gain;
+    result.UpdateRoundStats();
     if (debug) {
       cout << "gain: " << gain << endl;
     }
@@ -122,48 +163,107 @@ pair<set<int>, set<int>> ThresholdSampling(
     }
     if (S.size() == k) break;
   }
-  return make_pair(S, A);
+  return S;
+}
+
+set<int> DoubleGreedy(const EvaluationOracle& oracle, const set<int>& old_S,
+    const vector<int>& A, MaximizationResult& result, const Budget& budget,
+    double* value) {
+  PROFILE_SCOPE("DoubleGreedy");
+  std::mt19937 rng; rng.seed(RandomSeed());
+  std::uniform_real_distribution<double> coin(0, 1);
+  // X grows from old_S and Y shrinks from old_S + A until they meet, so
+  // both marginals come from running states instead of full queries.
+  ValueAccumulator X(oracle);
+  for (auto u : old_S) X.Add(u);
+  double old_S_value = X.value();
+  set<int> Y_members = old_S;
+  for (auto u : A) Y_members.insert(u);
+  ShrinkingValue Y(oracle, Y_members);
+  set<int> S;
+  int num_queries = old_S.size();
+  for (int i = 0; i < (int)A.size(); i++) {
+    if (budget.Exhausted()) {
+      // Elements not yet visited are left out, as in X.
+      result.truncated = true;
+      break;
+    }
+    int u = A[i];
+    double gain = X.Gain(u);
+    double add_gain = max(gain, 0.0);
+    double remove_gain = max(-Y.Loss(u), 0.0);
+    num_queries += 2;
+    if (add_gain + remove_gain == 0 ||
+        coin(rng) * (add_gain + remove_gain) < add_gain) {
+      X.Add(u, gain);
+      S.insert(u);
+    } else {
+      Y.Remove(u);
+    }
+  }
+  // Assumes results have been incremented for this round.
+  result.num_queries[result.num_rounds] += num_queries;
+  if (value != nullptr) *value = X.value() - old_S_value;
+  return S;
 }
 
 set<int> UnconstrainedMaximization(const EvaluationOracle& oracle,
-    const set<int>& old_S, vector<int> A, double epsilon, double delta,
-    MaximizationResult& result) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+    const set<int>& old_S, const vector<int>& A, double epsilon, double delta,
+    MaximizationResult& result, const Budget& budget, double* value,
+    UnconstrainedMethod method) {
+  if (method == UnconstrainedMethod::kDoubleGreedy) {
+    return DoubleGreedy(oracle, old_S, A, result, budget, value);
+  }
+  PROFILE_SCOPE("UnconstrainedMaximization");
+  std::mt19937 rng; rng.seed(RandomSeed());
   std::uniform_int_distribution<std::mt19937::result_type> dist(0, 1);
   int t = ceil(-log(delta) / log(1 + (4.0/3)*epsilon));
   t = min(t, 100);
   set<int> S;
   const double INF = 1e100;
   double max_gain = -INF;
-  for (int i = 0; i < t; i++) {
-    set<int> R;
+  if (budget.Exhausted()) {
+    result.truncated = true;
+    t = 0;  // Only count the samples that were evaluated.
+  }
+  // All samples are evaluated against old_S as one batch.
+  vector<set<int>> samples(t);
+  for (auto& R : samples) {
     for (auto u : A) {
       if (dist(rng)) R.insert(u);
     }
-    double gain = oracle.MarginalValue(R, old_S);
-    if (gain > max_gain) {
-      max_gain = gain;
-      S = R;
+  }
+  vector<double> gains;
+  oracle.MarginalValues(samples, old_S, gains);
+  for (int i = 0; i < t; i++) {
+    if (gains[i] > max_gain) {
+      max_gain = gains[i];
+      S.swap(samples[i]);  // The best sample is kept by swapping, not copied.
     }
   }
   // Assumes results have been incremented for this round.
   result.num_queries[result.num_rounds] += t;  
+  if (value != nullptr) *value = S.empty() ? 0 : max_gain;
   return S;
 }
 
-MaximizationResult AdaptiveNonmonotoneMaximization(
-    const EvaluationOracle& oracle, int k, double epsilon, double delta,
-    double c1, double c2, double c3, bool debug) {
-  std::mt19937 rng; rng.seed(std::random_device()());
-  double hat_epsilon = epsilon / 6;
-  MaximizationResult final_result;
-  int n = oracle.num_nodes();
-  set<int> S;
+double MaximumSingletonValue(const EvaluationOracle& oracle) {
+  PROFILE_SCOPE("MaximumSingletonValue");
   const double INF = 1e100;
   double delta_star = -INF;
-  for (int i = 0; i < n; i++) {
-    delta_star = max(delta_star, oracle.MarginalValue(i, S));
+  for (auto gain : oracle.SingletonValues()) {
+    delta_star = max(delta_star, gain);
   }
+  return delta_star;
+}
+
+MaximizationResult ThresholdLadder(const EvaluationOracle& oracle, int k,
+    double epsilon, double delta, double c1, double c2, double c3,
+    double delta_star, bool debug, const Budget& budget,
+    UnconstrainedMethod method) {
+  std::mt19937 rng; rng.seed(RandomSeed());
+  double hat_epsilon = epsilon / 6;
+  MaximizationResult final_result;
   int r = ceil(log(k) * (1/hat_epsilon + 0.5));  // Tighter upper bound
   double hat_delta = delta / (2 * (r + 1));
   if (debug) {
@@ -172,7 +272,27 @@ MaximizationResult AdaptiveNonmonotoneMaximization(
   }
   double max_function_value = 0;
   set<int> R;  // Stores final output set
-  for (int i = 0; i <= r; i++) {
+  ThresholdScratch scratch;
+  vector<int> A, U_vec;
+  // The first filter of every guess compares f({u}) with its tau. The
+  // singleton values are computed once (and cached by the oracle), and each
+  // guess starts from the elements above tau, a prefix of the elements in
+  // order of decreasing value. Elements within the coverage error bound of
+  // tau are kept, since MarginalsAtLeast may re-evaluate them.
+  const vector<double>& singletons = oracle.SingletonValues();
+  vector<int> by_value(oracle.num_nodes());
+  for (int u = 0; u < oracle.num_nodes(); u++) by_value[u] = u;
+  std::stable_sort(by_value.begin(), by_value.end(), [&](int a, int b) {
+    return singletons[a] > singletons[b];
+  });
+  long long start_queries = oracle.num_queries();
+  long long per_guess_queries = 0;
+  for (int i : budget.GuessOrder(r + 1)) {
+    if (budget.Exhausted()) {
+      final_result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("ThresholdLadder/guess");
     double tau = c1 * pow(1 + hat_epsilon, i) * delta_star / k;
     MaximizationResult result;
     set<int> empty_set;
@@ -180,73 +300,112 @@ MaximizationResult AdaptiveNonmonotoneMaximization(
     if (debug) {
       cout << i << "/" << r << ": " << tau << " " << new_constraint << endl;
     }
-    auto SA = ThresholdSampling(oracle, empty_set, new_constraint, tau,
-        hat_epsilon, hat_delta, c3, result, debug);
-    set<int> S = SA.first;
+    if (oracle.num_nodes() < c3 * new_constraint) {
+      // ThresholdSampling stops before its first filter, and the whole
+      // ground set goes on to UnconstrainedMaximization.
+      A.resize(oracle.num_nodes());
+      for (int u = 0; u < oracle.num_nodes(); u++) A[u] = u;
+    } else {
+      double lowest = tau - oracle.coverage_error_bound();
+      auto end = std::partition_point(by_value.begin(), by_value.end(),
+          [&](int u) { return singletons[u] >= lowest; });
+      A.assign(by_value.begin(), end);
+      sort(A.begin(), A.end());
+    }
+    set<int> S = ThresholdSampling(oracle, empty_set, new_constraint, tau,
+        hat_epsilon, hat_delta, c3, result, debug, budget, A, scratch,
+        &singletons);
     if (debug) {
       cout << "f(S): " << result.function_values.back() << endl;
     }
     // See if we can use the remaining elements.
-    vector<int> A;
-    for (auto x : SA.second) {
-      A.push_back(x);
-    }
     set<int> U, U_prime;
-    if (A.size() < c3 * k) {
+    if (A.size() < c3 * k && !result.truncated) {
       // Update maximization result
-      result.num_rounds++;
-      result.elements_added.push_back(set<int>());
-      result.marginal_gains.push_back(0);
-      result.function_values.push_back(result.function_values.back());
-      result.num_queries.push_back(result.num_queries.back());
+      result.AddRound();
       U = UnconstrainedMaximization(oracle, empty_set, A, hat_epsilon,
-          hat_delta, result);
-      vector<int> U_vec;
-      for (auto u : U) U_vec.push_back(u);
+          hat_delta, result, budget, nullptr, method);
+      U_vec.assign(U.begin(), U.end());
       shuffle(U_vec.begin(), U_vec.end(), rng);
-      double current_value = 0;
-      set<int> U_prefix;
-      set<int> best_prefix;
+      // The prefix values are running sums of the gains, and f(S) is the
+      // value carried over from threshold sampling, so no Value is needed.
+      ValueAccumulator U_prefix(oracle);
+      int best_length = 0;
       double best_value = 0;
       for (int j = 0; j < min(k, (int)U_vec.size()); j++) {
-        double gain = oracle.MarginalValue(U_vec[j], U_prefix);
+        U_prefix.Add(U_vec[j]);
         result.num_queries[result.num_rounds]++;
-        U_prefix.insert(U_vec[j]);
-        current_value += gain;
-        if (current_value > best_value) {
-          best_value = current_value;
-          best_prefix = U_prefix;
+        if (U_prefix.value() > best_value) {
+          best_value = U_prefix.value();
+          best_length = j + 1;
         }
       }
-      for (auto u : best_prefix) U_prime.insert(u);
+      U_prime.insert(U_vec.begin(), U_vec.begin() + best_length);
 
-      double S_value = oracle.Value(S);
-      double U_value = oracle.Value(U_prime);
+      double S_value = result.function_values[result.num_rounds];
+      double U_value = best_value;
       if (U_value > S_value) {
         if (debug) {
           cout << "Take random: " << U_value << " > " << S_value << endl;
         }
         S = U_prime;
-        result.elements_added[result.num_rounds] = S;
+        result.SetElementsAdded(S);
         result.marginal_gains[result.num_rounds] = U_value;
         result.function_values[result.num_rounds] = U_value;
       }
+      result.UpdateRoundStats();
     }
     if (debug) {
       cout << i << "/" << r << ": " << tau;
       cout << " --> " << result.function_values.back() << endl;
     }
     // Update final answer
+    per_guess_queries += result.num_queries.back();
+    bool truncated = result.truncated;
     if (result.function_values.back() > final_result.function_values.back()) {
       if (debug) cout << "found new best answer." << endl;
-      final_result = result;
-      R = S;
+      final_result = std::move(result);
+      R.swap(S);
     }
     if (debug) cout << endl;
+    if (truncated) {
+      final_result.truncated = true;
+      break;
+    }
+  }
+  if (debug) {
+    cout << "queries: " << per_guess_queries << " by the guesses, ";
+    cout << oracle.num_queries() - start_queries << " made after the ";
+    cout << oracle.num_nodes() << " shared singleton queries" << endl;
   }
+  final_result.solution.assign(R.begin(), R.end());
   return final_result;
 }
 
+MaximizationResult AdaptiveNonmonotoneMaximization(
+    const EvaluationOracle& oracle, int k, double epsilon, double delta,
+    double c1, double c2, double c3, bool debug, const Budget& budget,
+    UnconstrainedMethod method) {
+  double delta_star = MaximumSingletonValue(oracle);
+  return ThresholdLadder(oracle, k, epsilon, delta, c1, c2, c3, delta_star,
+      debug, budget, method);
+}
+
+vector<MaximizationResult> AdaptiveNonmonotoneMaximizationSweep(
+    const EvaluationOracle& oracle, const vector<int>& size_constraints,
+    double epsilon, double delta, double c1, double c2, double c3,
+    bool debug, const Budget& budget, UnconstrainedMethod method) {
+  // delta_star does not depend on k, so the singleton scan is shared.
+  double delta_star = MaximumSingletonValue(oracle);
+  vector<MaximizationResult> results;
+  for (auto k : size_constraints) {
+    if (debug) cout << "size constraint: " << k << endl;
+    results.push_back(ThresholdLadder(oracle, k, epsilon, delta, c1, c2, c3,
+        delta_star, debug, budget, method));
+  }
+  return results;
+}
+
 void TestAdaptiveNonmonotoneMaximization(const EvaluationOracle& oracle,
     int size_constraint, double epsilon, double delta, string output_path) {
   const int TRIALS = 10;
@@ -263,11 +422,35 @@ void TestAdaptiveNonmonotoneMaximization(const EvaluationOracle& oracle,
     output_filename += "constraint_" + int_to_str(size_constraint) + "-";
     output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
     output_filename += "adaptive_nonmonotone_maximization-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
 
+void TestAdaptiveNonmonotoneMaximizationSweep(const EvaluationOracle& oracle,
+    const vector<int>& size_constraints, double epsilon, double delta,
+    string output_path) {
+  const int TRIALS = 10;
+  cout << "Running adaptive_nonmonotone_maximization_sweep...\n";
+  const double c1 = 1.0/7.0;
+  const double c2 = 1.0;
+  const double c3 = 3.0;
+  for (int trial = 1; trial <= TRIALS; trial++) {
+    cout << " - trial: " << trial << "/" << TRIALS << endl;
+    const bool debug = false;
+    auto results = AdaptiveNonmonotoneMaximizationSweep(
+      oracle, size_constraints, epsilon, delta, c1, c2, c3, debug);
+    for (int i = 0; i < (int)size_constraints.size(); i++) {
+      string output_filename = output_path;
+      output_filename += "constraint_" + int_to_str(size_constraints[i]) + "-";
+      output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
+      output_filename += "adaptive_nonmonotone_maximization-";
+      output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
+      results[i].Write(output_filename);
+    }
+  }
+}
+
 void TestAdaptiveMaximization(const EvaluationOracle& oracle,
     int size_constraint, double epsilon, double delta, string output_path) {
   cout << "Running adaptive_maximization...\n";
@@ -280,6 +463,6 @@ void TestAdaptiveMaximization(const EvaluationOracle& oracle,
   string output_filename = output_path;
   output_filename += "constraint_" + int_to_str(size_constraint) + "-";
   output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
-  output_filename += "adaptive_maximization.txt";
+  output_filename += "adaptive_maximization" RESULT_EXTENSION;
   result.Write(output_filename);
 }
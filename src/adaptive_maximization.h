@@ -1,16 +1,54 @@
+#ifndef ADAPTIVE_MAXIMIZATION_H_
+#define ADAPTIVE_MAXIMIZATION_H_
+
+#include "budget.h"
 #include "evaluation_oracle.h"
 #include "maximization_result.h"
 
+// How the unconstrained stage of AdaptiveNonmonotoneMaximization and FANTOM
+// picks its subset: the best of O(log(1/delta)/epsilon) random subsets
+// evaluated as one batch, or DoubleGreedy.
+enum class UnconstrainedMethod { kRandomSubsets, kDoubleGreedy };
+
+// Returns a subset R of A with a large MarginalValue(R, old_S), which is
+// stored in *value if value is not null.
 std::set<int> UnconstrainedMaximization(const EvaluationOracle& oracle,
-    const std::set<int>& old_S, std::vector<int> A, double epsilon,
-    double delta, MaximizationResult& result);
+    const std::set<int>& old_S, const std::vector<int>& A, double epsilon,
+    double delta, MaximizationResult& result, const Budget& budget=Budget(),
+    double* value=nullptr,
+    UnconstrainedMethod method=UnconstrainedMethod::kRandomSubsets);
+
+// Randomized double greedy (Buchbinder et al.) for maximizing
+// MarginalValue(R, old_S) over subsets R of A: a 1/2-approximation in
+// expectation with 2|A| singleton queries, at the price of visiting the
+// elements of A one after another.
+std::set<int> DoubleGreedy(const EvaluationOracle& oracle,
+    const std::set<int>& old_S, const std::vector<int>& A,
+    MaximizationResult& result, const Budget& budget=Budget(),
+    double* value=nullptr);
 
 MaximizationResult AdaptiveNonmonotoneMaximization(
   const EvaluationOracle& oracle, int k, double epsilon, double delta,
-  double c1, double c2, double c3, bool debug=false);
+  double c1, double c2, double c3, bool debug=false,
+  const Budget& budget=Budget(),
+  UnconstrainedMethod method=UnconstrainedMethod::kRandomSubsets);
+
+// Runs the threshold ladder for each size constraint, sharing the singleton
+// scan for delta_star across all of them.
+std::vector<MaximizationResult> AdaptiveNonmonotoneMaximizationSweep(
+  const EvaluationOracle& oracle, const std::vector<int>& size_constraints,
+  double epsilon, double delta, double c1, double c2, double c3,
+  bool debug=false, const Budget& budget=Budget(),
+  UnconstrainedMethod method=UnconstrainedMethod::kRandomSubsets);
 
 void TestAdaptiveNonmonotoneMaximization(const EvaluationOracle& oracle,
     int size_constraint, double epsilon, double delta, std::string output_path);
 
+void TestAdaptiveNonmonotoneMaximizationSweep(const EvaluationOracle& oracle,
+    const std::vector<int>& size_constraints, double epsilon, double delta,
+    std::string output_path);
+
 void TestAdaptiveMaximization(const EvaluationOracle& oracle,
     int size_constraint, double epsilon, double delta, std::string output_path);
+
+#endif  // ADAPTIVE_MAXIMIZATION_H_
@@ -0,0 +1,108 @@
+// Aggregates binary result files (see MaximizationResult::WriteBinary) from
+// repeated trials into per-round means and standard deviations.
+//
+// Usage: ./aggregate output.txt trial_1.bin trial_2.bin ...
+//
+// The output uses the column names of MaximizationResult::WriteText for the
+// means, followed by a _std column for each, so the plot scripts can read it
+// like a single result. Trials that stopped after fewer rounds carry their
+// last row forward.
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "maximization_result.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::max;
+using std::ofstream;
+using std::sqrt;
+using std::string;
+using std::vector;
+
+void MeanAndStd(const vector<double>& values, double& mean, double& std) {
+  mean = 0;
+  for (auto x : values) mean += x;
+  mean /= values.size();
+  double variance = 0;
+  for (auto x : values) variance += (x - mean) * (x - mean);
+  std = values.size() > 1 ? sqrt(variance / (values.size() - 1)) : 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " output.txt trial.bin [trial.bin ...]";
+    cerr << endl;
+    return 1;
+  }
+  vector<MaximizationResult> trials;
+  int num_rounds = 0;
+  for (int i = 2; i < argc; i++) {
+    MaximizationResult result;
+    if (!result.ReadBinary(argv[i])) return 1;
+    num_rounds = max(num_rounds, result.num_rounds);
+    trials.push_back(result);
+  }
+
+  const int kNumFields = 9;
+  const string field_names[kNumFields] = {
+      "num_elements_added", "function_values", "num_queries",
+      "wall_times", "oracle_times", "peak_memory", "io_bytes",
+      "value_queries", "allocations"};
+  ofstream file(argv[1]);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << argv[1] << endl;
+    return 1;
+  }
+  file << "num_rounds";
+  for (int f = 0; f < kNumFields; f++) {
+    file << " " << field_names[f] << " " << field_names[f] << "_std";
+  }
+  file << endl;
+  for (int i = 0; i <= num_rounds; i++) {
+    file << i;
+    for (int f = 0; f < kNumFields; f++) {
+      vector<double> values;
+      for (const auto& trial : trials) {
+        int j = std::min(i, trial.num_rounds);
+        if (f == 0) values.push_back(trial.NumElementsAdded(j));
+        if (f == 1) values.push_back(trial.function_values[j]);
+        if (f == 2) values.push_back(trial.num_queries[j]);
+        if (f == 3) values.push_back(trial.wall_times[j]);
+        if (f == 4) values.push_back(trial.oracle_times[j]);
+        if (f == 5) values.push_back(trial.peak_memory[j]);
+        if (f == 6) values.push_back(trial.io_bytes[j]);
+        if (f == 7) values.push_back(trial.value_queries[j]);
+        if (f == 8) values.push_back(trial.allocations[j]);
+      }
+      double mean, std;
+      MeanAndStd(values, mean, std);
+      file << " " << mean << " " << std;
+    }
+    file << endl;
+  }
+
+  // Summary of the final solutions.
+  vector<double> final_values, final_queries, final_times;
+  int num_truncated = 0;
+  for (const auto& trial : trials) {
+    final_values.push_back(trial.function_values.back());
+    final_queries.push_back(trial.num_queries.back());
+    final_times.push_back(trial.wall_times.back());
+    if (trial.truncated) num_truncated++;
+  }
+  double mean, std;
+  cout << "trials: " << trials.size() << " (truncated: " << num_truncated;
+  cout << ")" << endl;
+  MeanAndStd(final_values, mean, std);
+  cout << "function_value: " << mean << " +/- " << std << endl;
+  MeanAndStd(final_queries, mean, std);
+  cout << "num_queries: " << mean << " +/- " << std << endl;
+  MeanAndStd(final_times, mean, std);
+  cout << "wall_time: " << mean << " +/- " << std << endl;
+  return 0;
+}
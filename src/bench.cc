@@ -0,0 +1,304 @@
+// Microbenchmarks of EvaluationOracle throughput for every objective and
+// query type, over a sweep of the ground set size n, the query set size |S|
+// and, for set marginals, the size |T| of the added set.
+//
+// Usage: ./bench output.csv [input_dir] [min_seconds]
+//
+// Random inputs are written to input_dir (default .) on the first run and
+// reused afterwards: a directed graph with 8 out-edges per node for
+// graph_cut and revenue, and a complete RBF similarity matrix of random
+// points for image_summarization and movie_recommendation. Each
+// measurement repeats its query for at least min_seconds (default 0.1) and
+// writes one CSV row with ns/query, queries/s and, where perf_event_open is
+// allowed, cycles, instructions, IPC and cache misses per query. Counters
+// that cannot be read are written as nan.
+//
+// Two more rows, with objective "threads" and n the number of tasks, time
+// the fixed cost of splitting a query over EvaluationOracle::num_threads()
+// threads (at least 2): "thread_spawn" starts and joins a std::thread per
+// extra task, "pool_dispatch" hands empty tasks to the WorkerPool. Against
+// the ns per similarity entry of the batch_marginal rows of
+// image_summarization (ns/query divided by n), they calibrate the
+// kMinEntriesPerThread threshold of evaluation_oracle.cc.
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "evaluation_oracle.h"
+#include "generators.h"
+#include "utilities.h"
+#include "worker_pool.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::mt19937;
+using std::ofstream;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+const int kNumCounters = 4;
+const char* const kCounterNames[kNumCounters] = {
+    "cycles", "instructions", "cache_references", "cache_misses"};
+
+// Hardware counters of the calling thread, read with perf_event_open. Where
+// the kernel or the container does not allow them, available() is false.
+class PerfCounters {
+ public:
+  PerfCounters() {
+    const uint64_t configs[kNumCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < kNumCounters; i++) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      // Counters are multiplexed when there are not enough of them, so the
+      // times let Stop scale the counts up to the whole interval.
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+  ~PerfCounters() {
+    for (auto fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+  }
+  bool available() const {
+    for (auto fd : fds_) {
+      if (fd < 0) return false;
+    }
+    return true;
+  }
+  void Start() {
+    if (!available()) return;
+    for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  // Returns false if some counter could not be read.
+  bool Stop(double counts[kNumCounters]) {
+    if (!available()) return false;
+    for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    for (int i = 0; i < kNumCounters; i++) {
+      uint64_t values[3];  // Count, time enabled, time running
+      if (read(fds_[i], values, sizeof(values)) != sizeof(values) ||
+          values[2] == 0) {
+        return false;
+      }
+      counts[i] = (double)values[0] * values[1] / values[2];
+    }
+    return true;
+  }
+
+ private:
+  int fds_[kNumCounters];
+};
+
+struct Measurement {
+  long long queries = 0;
+  double seconds = 0;
+  bool counted = false;
+  double counts[kNumCounters] = {0};
+};
+
+// Calls query(i) for i = 0, 1, ... in doubling batches until min_seconds
+// have passed. query returns the number of oracle queries it made.
+template <typename Query>
+Measurement Measure(Query query, double min_seconds, PerfCounters& counters) {
+  query(0);  // Warm up caches and lazily computed state.
+  Measurement m;
+  long long calls = 0, batch = 1;
+  auto start = std::chrono::steady_clock::now();
+  counters.Start();
+  while (true) {
+    for (long long b = 0; b < batch; b++) m.queries += query(calls++);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    m.seconds = elapsed.count();
+    if (m.seconds >= min_seconds) break;
+    batch *= 2;
+  }
+  m.counted = counters.Stop(m.counts);
+  return m;
+}
+
+bool Exists(const string& filename) {
+  ifstream file(filename);
+  return file.is_open();
+}
+
+// Random subset of {0, ..., n - 1} of the given size.
+set<int> RandomSet(int n, int size, mt19937& rng) {
+  vector<int> elements(n);
+  for (int i = 0; i < n; i++) elements[i] = i;
+  std::shuffle(elements.begin(), elements.end(), rng);
+  return set<int>(elements.begin(), elements.begin() + std::min(n, size));
+}
+
+void WriteRow(ofstream& file, const string& objective, int n, int s, int t,
+              const string& query, const Measurement& m) {
+  double ns_per_query = 1e9 * m.seconds / m.queries;
+  cout << objective << "\tn=" << n << "\t|S|=" << s << "\t|T|=" << t;
+  cout << "\t" << query << "\t" << ns_per_query << " ns/query" << endl;
+  file << objective << "," << n << "," << s << "," << t << "," << query;
+  file << "," << m.queries << "," << m.seconds << "," << ns_per_query;
+  file << "," << m.queries / m.seconds;
+  for (int i = 0; i < kNumCounters; i++) {
+    if (m.counted) {
+      file << "," << m.counts[i] / m.queries;
+    } else {
+      file << ",nan";
+    }
+  }
+  if (m.counted && m.counts[0] > 0 && m.counts[2] > 0) {
+    file << "," << m.counts[1] / m.counts[0];
+    file << "," << m.counts[3] / m.counts[2];
+  } else {
+    file << ",nan,nan";
+  }
+  file << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 4) {
+    cerr << "usage: " << argv[0] << " output.csv [input_dir] [min_seconds]";
+    cerr << endl;
+    return 1;
+  }
+  string input_dir = argc >= 3 ? string(argv[2]) + "/" : "./";
+  double min_seconds = argc == 4 ? atof(argv[3]) : 0.1;
+  const vector<string> objectives = {"graph_cut", "image_summarization",
+      "movie_recommendation", "revenue"};
+  const vector<int> node_counts = {250, 1000, 2000};
+  const vector<int> set_sizes = {1, 10, 100};
+  const vector<int> added_sizes = {10, 100};
+  const int kPoolSize = 16;  // Distinct random queries cycled through
+  const int kBatchSize = 64;  // Nodes per MarginalValues call
+
+  ofstream file(argv[1]);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << argv[1] << endl;
+    return 1;
+  }
+  file << "objective,n,set_size,added_size,query,queries,seconds,";
+  file << "ns_per_query,queries_per_second";
+  for (int i = 0; i < kNumCounters; i++) {
+    file << "," << kCounterNames[i] << "_per_query";
+  }
+  file << ",ipc,cache_miss_rate" << endl;
+
+  PerfCounters counters;
+  if (!counters.available()) {
+    cerr << "perf_event_open is not available: hardware counters are nan";
+    cerr << endl;
+  }
+  // The queries are timed here, so the per-query clock reads are skipped.
+  EvaluationOracle::set_query_timing(false);
+  volatile double sink = 0;  // Keeps the query results alive
+  for (const auto& objective : objectives) {
+    bool graph = objective == "graph_cut" || objective == "revenue";
+    for (auto n : node_counts) {
+      string filename = input_dir + "bench_" +
+          (graph ? "graph_" : "similarity_") + int_to_str(n) + ".txt";
+      if (!Exists(filename)) {
+        cout << "Writing " << filename << "..." << endl;
+        bool written = graph ? WriteRandomGraph(filename, n, 8, n) :
+                                WriteRandomSimilarities(filename, n, 16, n);
+        if (!written) return 1;
+      }
+      EvaluationOracle oracle(filename, objective);
+      if (oracle.num_nodes() != n) {
+        cerr << "could not read " << filename << endl;
+        return 1;
+      }
+      mt19937 rng(1);
+      for (auto s : set_sizes) {
+        if (s >= n) continue;
+        vector<set<int>> S(kPoolSize);
+        vector<int> nodes(kPoolSize);
+        vector<vector<int>> batches(kPoolSize);
+        for (int p = 0; p < kPoolSize; p++) {
+          S[p] = RandomSet(n, s, rng);
+          set<int> candidates = RandomSet(n, s + kBatchSize, rng);
+          for (auto u : candidates) {
+            if (!S[p].count(u)) batches[p].push_back(u);
+          }
+          batches[p].resize(std::min(kBatchSize, (int)batches[p].size()));
+          nodes[p] = batches[p][0];
+        }
+        WriteRow(file, objective, n, s, 0, "value", Measure([&](long long i) {
+          sink = sink + oracle.Value(S[i % kPoolSize]);
+          return 1;
+        }, min_seconds, counters));
+        WriteRow(file, objective, n, s, 1, "singleton_marginal",
+            Measure([&](long long i) {
+          sink = sink + oracle.MarginalValue(nodes[i % kPoolSize],
+                                             S[i % kPoolSize]);
+          return 1;
+        }, min_seconds, counters));
+        vector<double> values;
+        WriteRow(file, objective, n, s, 1, "batch_marginal",
+            Measure([&](long long i) {
+          const vector<int>& batch = batches[i % kPoolSize];
+          oracle.MarginalValues(batch, S[i % kPoolSize], values);
+          sink = sink + values[0];
+          return (int)batch.size();
+        }, min_seconds, counters));
+        for (auto t : added_sizes) {
+          if (s + t > n) continue;
+          vector<set<int>> T(kPoolSize);
+          for (int p = 0; p < kPoolSize; p++) T[p] = RandomSet(n, t, rng);
+          WriteRow(file, objective, n, s, t, "set_marginal",
+              Measure([&](long long i) {
+            sink = sink + oracle.MarginalValue(T[i % kPoolSize],
+                                               S[i % kPoolSize]);
+            return 1;
+          }, min_seconds, counters));
+        }
+      }
+    }
+  }
+  int num_tasks = std::max(2, EvaluationOracle::num_threads());
+  WriteRow(file, "threads", num_tasks, 0, 0, "thread_spawn",
+      Measure([&](long long i) {
+    vector<std::thread> workers;
+    for (int t = 1; t < num_tasks; t++) {
+      workers.emplace_back([&] { sink = sink + 1; });
+    }
+    for (auto& worker : workers) worker.join();
+    return 1;
+  }, min_seconds, counters));
+  auto empty_task = [&](int t) { sink = sink + t; };
+  WriteRow(file, "threads", num_tasks, 0, 0, "pool_dispatch",
+      Measure([&](long long i) {
+    WorkerPool::Get().Run(num_tasks, empty_task);
+    return 1;
+  }, min_seconds, counters));
+  return 0;
+}
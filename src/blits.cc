@@ -5,6 +5,7 @@
 #include <random>
 
 #include "blits.h"
+#include "profiler.h"
 #include "utilities.h"
 
 using std::cout;
@@ -15,27 +16,42 @@ using std::set;
 using std::string;
 using std::vector;
 
-double DeltaEstimate(int a, const set<int>& S, const set<int>& X,
-    const EvaluationOracle& oracle, int k, int r, MaximizationResult& result) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+namespace {
+
+// Temporaries of Sieve, owned by one run of Blits so that every round of
+// every guess reuses their capacity instead of allocating them again.
+struct SieveScratch {
+  vector<int> X, new_X;  // Sorted
+  vector<char> X_pos;  // X_pos[a]: whether a is in X_pos, for all nodes a
+  vector<int> sample;  // Shuffled copy of X
+  set<int> S_plus_R;  // S plus the current random sample R
+  vector<set<int>> samples;  // Of FunctionEstimate
+  vector<double> gains;
+};
+
+}  // namespace
+
+// S_plus_R must equal S on entry and is restored before returning.
+double DeltaEstimate(int a, const set<int>& S, set<int>& S_plus_R,
+    const vector<int>& X, vector<int>& v, const EvaluationOracle& oracle,
+    int k, int r, MaximizationResult& result) {
+  PROFILE_HOT_SCOPE("DeltaEstimate");
+  std::mt19937 rng; rng.seed(RandomSeed());
   const int number_of_samples = 100;
-  vector<int> v;
-  for (auto x : X) v.push_back(x);
+  v.assign(X.begin(), X.end());
   int size_of_R = min(k/r, (int)X.size());
 
-  set<int> mutable_S;
-  for (auto u : S) mutable_S.insert(u);
   double running_sum = 0;
   for (int i = 0; i < number_of_samples; i++) {
     if (S.count(a)) continue;  // 0 marginal gain here
     shuffle(v.begin(), v.end(), rng);
-    for (int j = 0; j < size_of_R; j++) mutable_S.insert(v[j]);
-    if (mutable_S.count(a)) mutable_S.erase(a);
-    double gain = oracle.MarginalValue(a, mutable_S);
+    for (int j = 0; j < size_of_R; j++) S_plus_R.insert(v[j]);
+    if (S_plus_R.count(a)) S_plus_R.erase(a);
+    double gain = oracle.MarginalValue(a, S_plus_R);
     running_sum += gain;
     for (int j = 0; j < size_of_R; j++) {
       if (S.count(v[j])) continue;
-      if (mutable_S.count(v[j])) mutable_S.erase(v[j]);
+      if (S_plus_R.count(v[j])) S_plus_R.erase(v[j]);
     }
   }
   double estimate = running_sum / number_of_samples;
@@ -43,125 +59,133 @@ double DeltaEstimate(int a, const set<int>& S, const set<int>& X,
   return estimate;
 }
 
-double FunctionEstimate(const set<int>& S, const set<int>& X,
-    const set<int>& X_pos, const EvaluationOracle& oracle, int k, int r,
+// The samples are evaluated against S as one batch.
+double FunctionEstimate(const set<int>& S, const vector<int>& X,
+    const vector<char>& X_pos, vector<int>& v, vector<set<int>>& samples,
+    vector<double>& gains, const EvaluationOracle& oracle, int k, int r,
     MaximizationResult& result) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+  PROFILE_SCOPE("FunctionEstimate");
+  std::mt19937 rng; rng.seed(RandomSeed());
   const int number_of_samples = 100;
   double running_sum = 0;
   int size_of_R = k/r;
-  vector<int> v;
-  for (auto x : X) v.push_back(x);
-  for (int i = 0; i < number_of_samples; i++) {
+  v.assign(X.begin(), X.end());
+  samples.resize(number_of_samples);
+  for (auto& T : samples) {
     shuffle(v.begin(), v.end(), rng);
-    set<int> T;
+    T.clear();
     for (int j = 0; j < size_of_R; j++) {
       int x = v[j];
-      if (X_pos.count(x)) T.insert(x);
+      if (X_pos[x]) T.insert(x);
     }
-    double gain = oracle.MarginalValue(T, S);
-    running_sum += gain;
   }
+  oracle.MarginalValues(samples, S, gains);
+  for (auto gain : gains) running_sum += gain;
   double estimate = running_sum / number_of_samples;
   result.num_queries[result.num_rounds] += number_of_samples;
   return estimate;
 }
 
 set<int> Sieve(const set<int>& S, int k, int i, int r, double epsilon,
-    double opt, const EvaluationOracle& oracle, MaximizationResult& result) {
-  std::mt19937 rng; rng.seed(std::random_device()());
+    double opt, const EvaluationOracle& oracle, MaximizationResult& result,
+    const Budget& budget, SieveScratch& scratch) {
+  PROFILE_SCOPE("Sieve");
+  std::mt19937 rng; rng.seed(RandomSeed());
   int n = oracle.num_nodes();
-  set<int> X;
+  vector<int>& X = scratch.X;
+  vector<int>& new_X = scratch.new_X;
+  vector<char>& X_pos = scratch.X_pos;
+  vector<int>& v = scratch.sample;
+  X.clear();
   for (int j = 0; j < n; j++) {
-    if (!S.count(j)) X.insert(j);  // Only consider unchosen nodes!
+    if (!S.count(j)) X.push_back(j);  // Only consider unchosen nodes!
   }
+  scratch.S_plus_R = S;  // Reuses the nodes of the previous call.
   double last_function_value = result.function_values.back();
   double t = (1 - epsilon/2)/2 *
       (pow(1-1.0/(double)r, i-1) * (1-epsilon/2)*opt - last_function_value);
   int sieve_loop_counter = 0;
   while (X.size() > k) {
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      return set<int>();
+    }
     // Update maximization result
-    result.num_rounds++;
-    result.elements_added.push_back(set<int>());
-    result.marginal_gains.push_back(0);
-    result.function_values.push_back(result.function_values.back());
-    result.num_queries.push_back(result.num_queries.back());
+    result.AddRound();
 
     sieve_loop_counter++;
     // Need to write Delta(a, S, X) function
-    set<int> X_pos;
+    X_pos.assign(n, false);
     for (auto a : X) {
-      if (DeltaEstimate(a, S, X, oracle, k, r, result) >= 0) {
-        X_pos.insert(a);
+      if (DeltaEstimate(a, S, scratch.S_plus_R, X, v, oracle, k, r,
+                        result) >= 0) {
+        X_pos[a] = true;
       }
     }
-    double function_estimate =
-        FunctionEstimate(S, X, X_pos, oracle, k, r, result);
+    double function_estimate = FunctionEstimate(S, X, X_pos, v,
+        scratch.samples, scratch.gains, oracle, k, r, result);
     if (function_estimate >= t/r) {
       // Return random sample
-      vector<int> v;
-      for (auto x : X) v.push_back(x);
+      v.assign(X.begin(), X.end());
       shuffle(v.begin(), v.end(), rng);
       int size_of_R = k/r;
       set<int> T;
       for (int j = 0; j < size_of_R; j++) {
-        if (X_pos.count(v[j]) && !S.count(v[j])) T.insert(v[j]);
+        if (X_pos[v[j]] && !S.count(v[j])) T.insert(v[j]);
       }
       // Update result
       double gain = oracle.MarginalValue(T, S);
-      result.elements_added[result.num_rounds] = T;
+      result.SetElementsAdded(T);
       result.marginal_gains[result.num_rounds] = gain;
       result.function_values[result.num_rounds] += gain;
+      result.UpdateRoundStats();
       return T;
     }
-    set<int> new_X;
+    new_X.clear();
     for (auto a : X) {
-      if (DeltaEstimate(a, S, X, oracle, k, r, result) >= (1 + epsilon/4)*t/k) {
-        new_X.insert(a);
+      if (DeltaEstimate(a, S, scratch.S_plus_R, X, v, oracle, k, r,
+                        result) >= (1 + epsilon/4)*t/k) {
+        new_X.push_back(a);
       }
     }
+    result.UpdateRoundStats();
     if (new_X == X) break;   // Needed condition to avoid their bug.
-    X = new_X;
+    X.swap(new_X);
   }
   // Outside of while loop
   // Update maximization result
-  result.num_rounds++;
-  result.elements_added.push_back(set<int>());
-  result.marginal_gains.push_back(0);
-  result.function_values.push_back(result.function_values.back());
-  result.num_queries.push_back(result.num_queries.back());
+  result.AddRound();
 
-  set<int> new_X_pos;
+  X_pos.assign(n, false);
   for (auto a : X) {
-    if (DeltaEstimate(a, S, X, oracle, k, r, result) >= 0) {
-      new_X_pos.insert(a);
+    if (DeltaEstimate(a, S, scratch.S_plus_R, X, v, oracle, k, r,
+                      result) >= 0) {
+      X_pos[a] = true;
     }
   }
-  set<int> X_pos = new_X_pos;
-  int fake_node_counter = -1;
-  int X_size = X.size();  // X may change size
-  for (int j = 0; j < k - X_size; j++) {
-    X.insert(fake_node_counter);
-    fake_node_counter--;
-  }
-  vector<int> v;
-  for (auto x : X) v.push_back(x);
+  // Pad X with fake nodes -1, -2, ... up to k elements, which sort before
+  // the real ones.
+  int X_size = X.size();
+  v.clear();
+  for (int j = k - X_size; j >= 1; j--) v.push_back(-j);
+  v.insert(v.end(), X.begin(), X.end());
   shuffle(v.begin(), v.end(), rng);
   int size_of_R = k/r;
   set<int> T;
   for (int j = 0; j < size_of_R; j++) {
-    if (X_pos.count(v[j]) && !S.count(v[j])) T.insert(v[j]);
+    if (v[j] >= 0 && X_pos[v[j]] && !S.count(v[j])) T.insert(v[j]);
   }
   // Update result
   double gain = oracle.MarginalValue(T, S);
-  result.elements_added[result.num_rounds] = T;
+  result.SetElementsAdded(T);
   result.marginal_gains[result.num_rounds] = gain;
   result.function_values[result.num_rounds] += gain;
+  result.UpdateRoundStats();
   return T;
 }
 
 MaximizationResult Blits(const EvaluationOracle& oracle,
-    int k, int r, double epsilon, bool debug) {
+    int k, int r, double epsilon, bool debug, const Budget& budget) {
   epsilon *= 0.5;  // Adjust epsilon since we're searching for OPT.
 
   MaximizationResult final_result;
@@ -175,27 +199,44 @@ MaximizationResult Blits(const EvaluationOracle& oracle,
   const double INF = 1e100;
   double ans_so_far = -INF;
   double delta_star = -INF;
-  for (int i = 0; i < n; i++) {
-    delta_star = max(delta_star, oracle.MarginalValue(i, S));
+  for (auto gain : oracle.SingletonValues()) {
+    delta_star = max(delta_star, gain);
   }
   int number_of_opt_guesses = ceil(log(k) / log(1 + epsilon));
-  for (int j = 0; j <= number_of_opt_guesses; j++) {
+  SieveScratch scratch;
+  for (int j : budget.GuessOrder(number_of_opt_guesses + 1)) {
+    if (budget.Exhausted()) {
+      final_result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("Blits/guess");
     double opt_guess = delta_star * pow(1 + epsilon, j);
     cout << j << "/" << number_of_opt_guesses << ": opt=" << opt_guess << endl;
     set<int> S;
     MaximizationResult result;
     for (int i = 1; i <= r; i++) {
-      set<int> T = Sieve(S, k, i, r, epsilon, opt_guess, oracle, result);
+      if (budget.Exhausted()) {
+        result.truncated = true;
+        break;
+      }
+      set<int> T = Sieve(S, k, i, r, epsilon, opt_guess, oracle, result,
+                         budget, scratch);
       for (auto u : T) S.insert(u);
       cout << " - inner round: " << i << "/" << r 
            << ": |S| = " << S.size() << ", ans = "
            << result.function_values.back() << endl;
     }
+    bool truncated = result.truncated;
+    result.solution.assign(S.begin(), S.end());
     if (result.function_values.back() > ans_so_far) {
       ans_so_far = result.function_values.back();
-      final_result = result;
+      final_result = std::move(result);
       cout << "new maximizer: " << ans_so_far << endl;
     }
+    if (truncated) {
+      final_result.truncated = true;
+      break;
+    }
   }
   return final_result;
 }
@@ -213,7 +254,7 @@ void TestBlits(const EvaluationOracle& oracle,
     output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
     output_filename += "rounds_" + int_to_str(rounds) + "-";
     output_filename += "blits-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
@@ -1,8 +1,9 @@
+#include "budget.h"
 #include "evaluation_oracle.h"
 #include "maximization_result.h"
 
-MaximizationResult Blits(const EvaluationOracle& oracle, int k, double epsilon,
-    bool debug=false);
+MaximizationResult Blits(const EvaluationOracle& oracle, int k, int r,
+    double epsilon, bool debug=false, const Budget& budget=Budget());
 
 void TestBlits(const EvaluationOracle& oracle, int size_constraint, int rounds,
     double epsilon, std::string output_path);
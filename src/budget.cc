@@ -0,0 +1,56 @@
+#include "budget.h"
+
+#include <queue>
+
+using std::pair;
+using std::queue;
+using std::vector;
+
+Budget::Budget()
+    : oracle_(nullptr), time_limit_(0), query_limit_(0), start_queries_(0),
+      start_time_(std::chrono::steady_clock::now()) {}
+
+Budget::Budget(const EvaluationOracle& oracle, double time_limit,
+               long long query_limit)
+    : oracle_(&oracle), time_limit_(time_limit), query_limit_(query_limit),
+      start_queries_(oracle.num_queries()),
+      start_time_(std::chrono::steady_clock::now()) {}
+
+bool Budget::Exhausted() const {
+  if (query_limit_ > 0 && QueriesUsed() >= query_limit_) return true;
+  if (time_limit_ > 0 && ElapsedSeconds() >= time_limit_) return true;
+  return false;
+}
+
+double Budget::ElapsedSeconds() const {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_time_;
+  return elapsed.count();
+}
+
+long long Budget::QueriesUsed() const {
+  if (oracle_ == nullptr) return 0;
+  return oracle_->num_queries() - start_queries_;
+}
+
+vector<int> Budget::GuessOrder(int num_guesses) const {
+  vector<int> order;
+  if (!limited()) {
+    for (int i = 0; i < num_guesses; i++) order.push_back(i);
+    return order;
+  }
+  // Breadth-first bisection: midpoint, then quartiles, and so on.
+  queue<pair<int, int>> intervals;
+  intervals.push(std::make_pair(0, num_guesses - 1));
+  while (!intervals.empty()) {
+    int lo = intervals.front().first;
+    int hi = intervals.front().second;
+    intervals.pop();
+    if (lo > hi) continue;
+    int mid = (lo + hi) / 2;
+    order.push_back(mid);
+    intervals.push(std::make_pair(lo, mid - 1));
+    intervals.push(std::make_pair(mid + 1, hi));
+  }
+  return order;
+}
@@ -0,0 +1,35 @@
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#include <chrono>
+#include <vector>
+
+#include "evaluation_oracle.h"
+
+// Wall-clock and oracle query limits for anytime runs. Algorithms check the
+// budget between rounds and guesses, and once it is exhausted they return the
+// best feasible solution found so far with result.truncated set. A limit
+// <= 0 means that resource is unlimited.
+class Budget {
+ public:
+  Budget();
+  Budget(const EvaluationOracle& oracle, double time_limit,
+         long long query_limit);
+  bool limited() const { return time_limit_ > 0 || query_limit_ > 0; }
+  bool Exhausted() const;
+  double ElapsedSeconds() const;
+  long long QueriesUsed() const;
+  // Order in which to try num_guesses geometric guesses. Unlimited runs keep
+  // the natural order. Limited runs bisect the range so that every prefix of
+  // the order covers it evenly, and a truncated run has still tried a guess
+  // close to the best one.
+  std::vector<int> GuessOrder(int num_guesses) const;
+ private:
+  const EvaluationOracle* oracle_;
+  double time_limit_;
+  long long query_limit_;
+  long long start_queries_;
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+#endif  // BUDGET_H_
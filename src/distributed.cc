@@ -0,0 +1,281 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <set>
+
+#include "adaptive_maximization.h"
+#include "distributed.h"
+#include "random_greedy.h"
+#include "utilities.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::mt19937;
+using std::ofstream;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Pipes may transfer fewer bytes than requested, so both ends loop.
+bool WriteAll(int fd, const void* data, size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = write(fd, p, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    p += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, void* data, size_t size) {
+  char* p = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t num_read = read(fd, p, size);
+    if (num_read < 0 && errno == EINTR) continue;
+    if (num_read <= 0) return false;
+    p += num_read;
+    size -= num_read;
+  }
+  return true;
+}
+
+// What a worker sends back: its solution in global ids and its cost.
+struct ShardReport {
+  vector<int32_t> solution;
+  double seconds;
+  long long queries;
+};
+
+bool WriteReport(int fd, const ShardReport& report) {
+  int32_t size = report.solution.size();
+  return WriteAll(fd, &size, sizeof(size)) &&
+         WriteAll(fd, report.solution.data(), size * sizeof(int32_t)) &&
+         WriteAll(fd, &report.seconds, sizeof(report.seconds)) &&
+         WriteAll(fd, &report.queries, sizeof(report.queries));
+}
+
+bool ReadReport(int fd, ShardReport& report) {
+  int32_t size = 0;
+  if (!ReadAll(fd, &size, sizeof(size)) || size < 0) return false;
+  report.solution.resize(size);
+  return ReadAll(fd, report.solution.data(), size * sizeof(int32_t)) &&
+         ReadAll(fd, &report.seconds, sizeof(report.seconds)) &&
+         ReadAll(fd, &report.queries, sizeof(report.queries));
+}
+
+MaximizationResult RunBaseAlgorithm(const EvaluationOracle& oracle,
+    int size_constraint, const string& base_algorithm, double epsilon,
+    double delta) {
+  if (base_algorithm == "greedy") {
+    return Greedy(oracle, size_constraint);
+  } else if (base_algorithm == "random_greedy") {
+    return RandomGreedy(oracle, size_constraint);
+  } else {
+    const double c1 = 1.0/7.0;
+    const double c2 = 1.0;
+    const double c3 = 3.0;
+    return AdaptiveNonmonotoneMaximization(oracle, size_constraint, epsilon,
+        delta, c1, c2, c3);
+  }
+}
+
+}  // namespace
+
+MaximizationResult RandGreeDI(const EvaluationOracle& oracle,
+    int size_constraint, int num_shards, string base_algorithm,
+    double epsilon, double delta, DistributedStats* stats, bool debug) {
+  assert(base_algorithm == "greedy" ||
+         base_algorithm == "random_greedy" ||
+         base_algorithm == "adaptive_nonmonotone_maximization");
+  assert(num_shards >= 1);
+  auto start = std::chrono::steady_clock::now();
+  DistributedStats local_stats;
+  DistributedStats& s = stats ? *stats : local_stats;
+
+  // Assign each element to a shard uniformly at random.
+  mt19937 rng; rng.seed(RandomSeed());
+  std::uniform_int_distribution<int> shard_dist(0, num_shards - 1);
+  vector<vector<int>> shards(num_shards);
+  for (int i = 0; i < oracle.num_nodes(); i++) {
+    shards[shard_dist(rng)].push_back(i);
+  }
+
+  // Round 1: one worker per shard. Buffered output is flushed first so that
+  // the workers do not print it again.
+  cout.flush();
+  cerr.flush();
+  vector<pid_t> workers(num_shards, -1);
+  vector<int> read_fds(num_shards, -1);
+  for (int i = 0; i < num_shards; i++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      cerr << "RandGreeDI: pipe failed for shard " << i << endl;
+      continue;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      // The WorkerPool threads of the parent do not exist in the child, and
+      // the pool's mutex may have been copied locked, so the shard is
+      // evaluated on this thread alone.
+      EvaluationOracle::set_num_threads(1);
+      auto worker_start = std::chrono::steady_clock::now();
+      EvaluationOracle view(oracle, shards[i]);
+      MaximizationResult result = RunBaseAlgorithm(view, size_constraint,
+          base_algorithm, epsilon, delta);
+      ShardReport report;
+      for (int u : result.solution) {
+        report.solution.push_back(view.global_id(u));
+      }
+      report.seconds = SecondsSince(worker_start);
+      report.queries = result.num_queries.back();
+      bool ok = WriteReport(fds[1], report);
+      close(fds[1]);
+      _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+      cerr << "RandGreeDI: fork failed for shard " << i << endl;
+      close(fds[0]);
+      continue;
+    }
+    workers[i] = pid;
+    read_fds[i] = fds[0];
+  }
+
+  s.shard_sizes.assign(num_shards, 0);
+  s.shard_solution_sizes.assign(num_shards, 0);
+  s.shard_seconds.assign(num_shards, 0);
+  s.shard_queries.assign(num_shards, 0);
+  vector<vector<int>> shard_solutions(num_shards);
+  set<int> merged;
+  long long shard_queries = 0;
+  for (int i = 0; i < num_shards; i++) {
+    s.shard_sizes[i] = shards[i].size();
+    if (workers[i] < 0) continue;
+    ShardReport report;
+    bool ok = ReadReport(read_fds[i], report);
+    close(read_fds[i]);
+    int status = 0;
+    waitpid(workers[i], &status, 0);
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << "RandGreeDI: worker for shard " << i << " failed" << endl;
+      continue;
+    }
+    shard_solutions[i].assign(report.solution.begin(), report.solution.end());
+    merged.insert(shard_solutions[i].begin(), shard_solutions[i].end());
+    s.shard_solution_sizes[i] = report.solution.size();
+    s.shard_seconds[i] = report.seconds;
+    s.shard_queries[i] = report.queries;
+    shard_queries += report.queries;
+  }
+  s.shard_round_seconds = SecondsSince(start);
+
+  // Round 2: the base algorithm on the union of the shard solutions.
+  auto merge_start = std::chrono::steady_clock::now();
+  vector<int> merged_ids(merged.begin(), merged.end());
+  EvaluationOracle merged_view(oracle, merged_ids);
+  MaximizationResult result = RunBaseAlgorithm(merged_view, size_constraint,
+      base_algorithm, epsilon, delta);
+  result.MapElements(merged_ids);
+  s.merge_queries = result.num_queries.back();
+
+  // The best shard solution can beat the merged one for non-monotone
+  // objectives, so it is kept as a final round when it does.
+  double merged_value = result.function_values.back();
+  int best_shard = -1;
+  double best_shard_value = merged_value;
+  for (int i = 0; i < num_shards; i++) {
+    if (shard_solutions[i].empty()) continue;
+    set<int> S(shard_solutions[i].begin(), shard_solutions[i].end());
+    double value = oracle.Value(S);
+    s.merge_queries++;
+    if (value > best_shard_value) {
+      best_shard_value = value;
+      best_shard = i;
+    }
+  }
+  for (int& queries : result.num_queries) queries += shard_queries;
+  if (best_shard >= 0) {
+    result.AddRound();
+    const vector<int>& S = shard_solutions[best_shard];
+    result.SetElementsAdded(set<int>(S.begin(), S.end()));
+    result.marginal_gains[result.num_rounds] = best_shard_value - merged_value;
+    result.function_values[result.num_rounds] = best_shard_value;
+    result.num_queries[result.num_rounds] += num_shards;
+    result.UpdateRoundStats();
+    result.solution = S;
+  }
+  s.merge_seconds = SecondsSince(merge_start);
+  s.total_seconds = SecondsSince(start);
+
+  if (debug) {
+    for (int i = 0; i < num_shards; i++) {
+      cout << "shard " << i << ": |V_i|: " << s.shard_sizes[i]
+           << "\t|S_i|: " << s.shard_solution_sizes[i]
+           << "\tseconds: " << s.shard_seconds[i]
+           << "\tqueries: " << s.shard_queries[i] << endl;
+    }
+    cout << "merge: |union|: " << merged_ids.size()
+         << "\tseconds: " << s.merge_seconds
+         << "\tqueries: " << s.merge_queries << endl;
+    cout << "f(S): " << result.function_values.back()
+         << "\tbest shard: " << best_shard
+         << "\ttotal seconds: " << s.total_seconds << endl;
+  }
+  return result;
+}
+
+void TestRandGreeDI(const EvaluationOracle& oracle, int size_constraint,
+    int num_shards, string base_algorithm, double epsilon, double delta,
+    string output_path) {
+  const int TRIALS = 10;
+  cout << "Running rand_greedi with " << base_algorithm << "...\n";
+  for (int trial = 1; trial <= TRIALS; trial++) {
+    cout << " - trial: " << trial << "/" << TRIALS << endl;
+    const bool debug = true;
+    DistributedStats stats;
+    auto result = RandGreeDI(oracle, size_constraint, num_shards,
+        base_algorithm, epsilon, delta, &stats, debug);
+    string output_filename = output_path;
+    output_filename += "constraint_" + int_to_str(size_constraint) + "-";
+    output_filename += "shards_" + int_to_str(num_shards) + "-";
+    output_filename += "rand_greedi_" + base_algorithm + "-";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS);
+    result.Write(output_filename + RESULT_EXTENSION);
+
+    // Per-shard and merge timings, one shard per line.
+    ofstream file(output_filename + ".shards.txt");
+    if (!file.is_open()) continue;
+    file << "shard size solution_size seconds queries" << endl;
+    for (int i = 0; i < num_shards; i++) {
+      file << i << " " << stats.shard_sizes[i] << " "
+           << stats.shard_solution_sizes[i] << " " << stats.shard_seconds[i]
+           << " " << stats.shard_queries[i] << endl;
+    }
+    file << "shard_round_seconds " << stats.shard_round_seconds << endl;
+    file << "merge_seconds " << stats.merge_seconds << endl;
+    file << "merge_queries " << stats.merge_queries << endl;
+    file << "total_seconds " << stats.total_seconds << endl;
+  }
+}
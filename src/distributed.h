@@ -0,0 +1,41 @@
+#ifndef DISTRIBUTED_H_
+#define DISTRIBUTED_H_
+
+#include <string>
+#include <vector>
+
+#include "evaluation_oracle.h"
+#include "maximization_result.h"
+
+// Timings of a partitioned run. Shards run concurrently, so the wall time of
+// the first round is the maximum (not the sum) of shard_seconds.
+struct DistributedStats {
+  std::vector<int> shard_sizes;
+  std::vector<int> shard_solution_sizes;
+  std::vector<double> shard_seconds;  // Measured inside each worker
+  std::vector<long long> shard_queries;
+  double shard_round_seconds;  // From the first fork to the last exit
+  double merge_seconds;
+  long long merge_queries;
+  double total_seconds;
+};
+
+// Distributed Submodular Maximization (RandGreeDI): splits the ground set
+// uniformly at random into num_shards shards, runs base_algorithm on each
+// shard in its own worker process, then runs it again on the union of the
+// shard solutions. Returns the better of the merged solution and the best
+// shard solution. Workers are forked from this process and send their
+// solutions back over pipes, standing in for separate machines.
+//
+// base_algorithm is one of "greedy", "random_greedy" or
+// "adaptive_nonmonotone_maximization" (which uses epsilon and delta).
+MaximizationResult RandGreeDI(const EvaluationOracle& oracle,
+    int size_constraint, int num_shards, std::string base_algorithm,
+    double epsilon, double delta, DistributedStats* stats=nullptr,
+    bool debug=false);
+
+void TestRandGreeDI(const EvaluationOracle& oracle, int size_constraint,
+    int num_shards, std::string base_algorithm, double epsilon, double delta,
+    std::string output_path);
+
+#endif  // DISTRIBUTED_H_
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "edge_list.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char kEdgesMagic[4] = {'M', 'X', 'E', '1'};
+// Text headers are padded to a fixed width so Close can rewrite them.
+const int kTextHeaderBytes = 48;
+const size_t kBufferEdges = 1 << 16;
+
+bool HasSuffix(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static_assert(sizeof(Edge) == 16, "Edge records must be packed");
+
+struct BinaryHeader {
+  char magic[4];
+  int32_t num_nodes;
+  int64_t num_edges;
+};
+
+}  // namespace
+
+EdgeListReader::EdgeListReader(const string& filename)
+    : open_(false), binary_(HasSuffix(filename, ".edges")), num_nodes_(0),
+      num_edges_(0), next_(0), buffer_position_(0) {
+  file_.open(filename, binary_ ? std::ios::binary : std::ios::in);
+  if (!file_.is_open()) return;
+  if (binary_) {
+    BinaryHeader header;
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file_ || memcmp(header.magic, kEdgesMagic, 4) != 0) {
+      cerr << "not a binary edge list: " << filename << endl;
+      return;
+    }
+    num_nodes_ = header.num_nodes;
+    num_edges_ = header.num_edges;
+  } else {
+    file_ >> num_nodes_ >> num_edges_;
+    if (!file_) return;
+  }
+  open_ = true;
+}
+
+bool EdgeListReader::Next(Edge& edge) {
+  if (!open_ || next_ == num_edges_) return false;
+  if (!binary_) {
+    file_ >> edge.from >> edge.to >> edge.weight;
+    if (!file_) return false;
+    next_++;
+    return true;
+  }
+  if (buffer_position_ == buffer_.size()) {
+    size_t count = std::min<long long>(kBufferEdges, num_edges_ - next_);
+    buffer_.resize(count);
+    file_.read(reinterpret_cast<char*>(buffer_.data()), count * sizeof(Edge));
+    if (!file_) return false;
+    buffer_position_ = 0;
+  }
+  edge = buffer_[buffer_position_++];
+  next_++;
+  return true;
+}
+
+EdgeListWriter::EdgeListWriter(const string& filename, int num_nodes)
+    : binary_(HasSuffix(filename, ".edges")), num_nodes_(num_nodes),
+      num_edges_(0) {
+  file_.open(filename, std::ios::binary);
+  if (!file_.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return;
+  }
+  // Placeholder header of the final size.
+  if (binary_) {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  } else {
+    file_ << string(kTextHeaderBytes - 1, ' ') << "\n";
+  }
+}
+
+void EdgeListWriter::Encode(const vector<Edge>& edges, bool binary,
+                            string& bytes) {
+  if (binary) {
+    bytes.append(reinterpret_cast<const char*>(edges.data()),
+                 edges.size() * sizeof(Edge));
+    return;
+  }
+  char line[64];
+  for (const auto& edge : edges) {
+    int length = snprintf(line, sizeof(line), "%d %d %.10g\n", edge.from,
+                          edge.to, edge.weight);
+    bytes.append(line, length);
+  }
+}
+
+void EdgeListWriter::Write(const string& bytes, long long num_edges) {
+  file_.write(bytes.data(), bytes.size());
+  num_edges_ += num_edges;
+}
+
+void EdgeListWriter::Add(const Edge& edge) {
+  string bytes;
+  Encode(vector<Edge>(1, edge), binary_, bytes);
+  Write(bytes, 1);
+}
+
+bool EdgeListWriter::Close() {
+  if (!file_.is_open()) return false;
+  file_.seekp(0);
+  if (binary_) {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kEdgesMagic, sizeof(kEdgesMagic));
+    header.num_nodes = num_nodes_;
+    header.num_edges = num_edges_;
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  } else {
+    // Leading whitespace is skipped by the readers.
+    string header = std::to_string(num_nodes_) + " " +
+                    std::to_string(num_edges_);
+    file_ << string(kTextHeaderBytes - 1 - header.size(), ' ') << header;
+  }
+  bool ok = (bool)file_;
+  file_.close();
+  return ok;
+}
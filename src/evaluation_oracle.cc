@@ -1,11 +1,19 @@
 #include "evaluation_oracle.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
-#include <fstream>
 #include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+
+#include "edge_list.h"
+#include "maximization_result.h"
+#include "profiler.h"
+#include "worker_pool.h"
 
-using std::ifstream;
 using std::make_pair;
 using std::max;
 using std::pair;
@@ -14,7 +22,137 @@ using std::sqrt;
 using std::string;
 using std::vector;
 
-EvaluationOracle::EvaluationOracle(string filename, string function_name) {
+namespace {
+
+bool HasSuffix(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool query_timing = true;
+double total_query_seconds = 0;
+long long total_value_queries = 0;
+int num_threads_setting = 0;  // Hardware threads if <= 0
+
+// Fewer nodes (or sets) per thread are not worth handing to a worker.
+const int kMinNodesPerThread = 64;
+const int kMinSetsPerThread = 8;
+
+// Oracles with at least kMinNodesForRowBlocks nodes also split a single
+// query over its rows: coverage and revenue sums are then taken over fixed
+// blocks of kRowBlockSize rows and added up in block order, so a value does
+// not depend on how many threads computed it. A thread only takes part for
+// at least kMinEntriesPerThread matrix entries (or edges) of work: about
+// 0.5 ms at the 3-4 ns per entry of the coverage scans in ./bench, so even
+// the 16 us ./bench measures for starting and joining a thread, far more
+// than a WorkerPool dispatch, would stay below 4% of it.
+const int kRowBlockSize = 4096;
+const int kMinNodesForRowBlocks = 4 * kRowBlockSize;
+const long long kMinEntriesPerThread = 1 << 17;
+
+// Set on the threads that evaluate the queries of a batch in parallel, whose
+// queries then leave their rows to a single thread.
+thread_local bool in_batch_worker = false;
+
+class BatchWorkerScope {
+ public:
+  explicit BatchWorkerScope(bool enabled) : saved_(in_batch_worker) {
+    if (enabled) in_batch_worker = true;
+  }
+  ~BatchWorkerScope() { in_batch_worker = saved_; }
+ private:
+  bool saved_;
+};
+
+// Calls body(begin, end) on num_workers contiguous ranges of [0, num_rows)
+// on the threads of the WorkerPool, the first one on the calling thread.
+template <typename Body>
+void ParallelRows(int num_rows, int num_workers, Body body) {
+  if (num_workers <= 1) {
+    body(0, num_rows);
+    return;
+  }
+  auto range = [&](int w) {
+    body((long long)num_rows * w / num_workers,
+         (long long)num_rows * (w + 1) / num_workers);
+  };
+  WorkerPool::Get().Run(num_workers, range);
+}
+
+// sums[k] += the sum over the blocks of kRowBlockSize rows of [0, num_rows),
+// in increasing order, of the partial sums body(begin, end, partial) adds to
+// a zeroed partial[k]. Blocks are spread over up to num_workers threads.
+template <typename Body>
+void BlockedRowSums(int num_rows, int num_workers, vector<double>& sums,
+                    Body body) {
+  int num_blocks = (num_rows + kRowBlockSize - 1) / kRowBlockSize;
+  num_workers = std::min(num_workers, num_blocks);
+  if (num_workers <= 1) {
+    vector<double> partial;
+    for (int b = 0; b < num_blocks; b++) {
+      partial.assign(sums.size(), 0);
+      body(b * kRowBlockSize, std::min(num_rows, (b + 1) * kRowBlockSize),
+           partial);
+      for (int k = 0; k < (int)sums.size(); k++) sums[k] += partial[k];
+    }
+    return;
+  }
+  vector<vector<double>> partials(num_blocks);
+  ParallelRows(num_blocks, num_workers, [&](int first, int last) {
+    for (int b = first; b < last; b++) {
+      partials[b].assign(sums.size(), 0);
+      body(b * kRowBlockSize, std::min(num_rows, (b + 1) * kRowBlockSize),
+           partials[b]);
+    }
+  });
+  for (const auto& partial : partials) {
+    for (int k = 0; k < (int)sums.size(); k++) sums[k] += partial[k];
+  }
+}
+
+// Temporaries of the objective queries, one set per thread since queries
+// also run on the workers of SingletonValues. They keep their capacity, so
+// a query only allocates when it is larger than every earlier query on its
+// thread.
+struct QueryScratch {
+  vector<int> members, candidates, new_members;
+  vector<double> row_maxima, new_row_maxima, coverage, diversity;
+  // Used by the single-node wrappers around the batched queries.
+  vector<int> node;
+  vector<double> value;
+  vector<char> above;
+  set<int> query_set;  // Its nodes are reused by copy assignment.
+  Query traced_query;
+};
+
+thread_local QueryScratch query_scratch;
+
+// Adds the lifetime of the enclosing oracle query to total_query_seconds.
+class QueryTimer {
+ public:
+  QueryTimer() : enabled_(query_timing) {
+    if (enabled_) start_ = std::chrono::steady_clock::now();
+  }
+  ~QueryTimer() {
+    if (!enabled_) return;
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    total_query_seconds += elapsed.count();
+  }
+ private:
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace
+
+EvaluationOracle::EvaluationOracle(string filename, string function_name,
+                                   int tile_cache_size)
+    : parent_(nullptr), coverage_error_bound_(0),
+      exact_near_threshold_(false), exact_coverage_(false),
+      query_trace_(nullptr), num_value_queries_(0),
+      num_singleton_queries_(0), num_set_queries_(0),
+      num_exact_reevaluations_(0), generation_(0), singleton_generation_(0) {
   // Reads and constructs the 0-index directed multigraph stored in filename.
   assert(function_name == "graph_cut" ||
          function_name == "image_summarization" ||
@@ -23,44 +161,57 @@ EvaluationOracle::EvaluationOracle(string filename, string function_name) {
   function_name_ = function_name;
   if (function_name == "graph_cut" || 
       function_name == "revenue") {  // Use adjacency list
-    ifstream file(filename);
+    EdgeListReader file(filename);
     if (file.is_open()) {
-      file >> num_nodes_ >> num_edges_;
+      num_nodes_ = file.num_nodes();
+      num_edges_ = file.num_edges();
       adjacency_list_.resize(num_nodes_);
       reverse_adjacency_list_.resize(num_nodes_);
-      int from_node, to_node;
-      double weight;
-      for (int i = 0; i < num_edges_; i++) {
-        file >> from_node >> to_node >> weight;
-        assert(0 <= from_node && from_node < num_nodes_);
-        assert(0 <= to_node && to_node < num_nodes_);
-        adjacency_list_[from_node].push_back(make_pair(to_node, weight));
-        reverse_adjacency_list_[to_node].push_back(
-            make_pair(from_node, weight));
-      }
-      file.close();
+      Edge edge;
+      while (file.Next(edge)) {
+        assert(0 <= edge.from && edge.from < num_nodes_);
+        assert(0 <= edge.to && edge.to < num_nodes_);
+        adjacency_list_[edge.from].push_back(make_pair(edge.to, edge.weight));
+        reverse_adjacency_list_[edge.to].push_back(
+            make_pair(edge.from, edge.weight));
+      }
     } else {
       num_nodes_ = 0;
       num_edges_ = 0;
     }
   } else if (function_name == "image_summarization" ||
              function_name == "movie_recommendation") {  // Use adjacency matrix
-    ifstream file(filename);
+    if (HasSuffix(filename, ".tiles")) {
+      tiled_matrix_ = std::make_shared<TiledMatrix>(filename, tile_cache_size);
+      num_nodes_ = tiled_matrix_->num_nodes();
+      num_edges_ = tiled_matrix_->num_edges();
+      return;
+    }
+    if (HasSuffix(filename, ".features")) {
+      feature_matrix_ = std::make_shared<FeatureMatrix>(filename);
+      num_nodes_ = feature_matrix_->num_nodes();
+      num_edges_ = 0;  // Implicitly complete
+      return;
+    }
+    EdgeListReader file(filename);
     if (file.is_open()) {
-      file >> num_nodes_ >> num_edges_;
+      num_nodes_ = file.num_nodes();
+      num_edges_ = file.num_edges();
       adjacency_matrix_.resize(num_nodes_);
       for (int i = 0; i < num_nodes_; i++) {
         adjacency_matrix_[i].resize(num_nodes_);
       }
-      int from_node, to_node;
-      double weight;
-      for (int i = 0; i < num_edges_; i++) {
-        file >> from_node >> to_node >> weight;
-        assert(0 <= from_node && from_node < num_nodes_);
-        assert(0 <= to_node && to_node < num_nodes_);
-        adjacency_matrix_[from_node][to_node] = weight;
+      Edge edge;
+      while (file.Next(edge)) {
+        assert(0 <= edge.from && edge.from < num_nodes_);
+        assert(0 <= edge.to && edge.to < num_nodes_);
+        adjacency_matrix_[edge.from][edge.to] = edge.weight;
+      }
+      if (SymmetricMatrix::IsSymmetric(adjacency_matrix_)) {
+        symmetric_matrix_ =
+            std::make_shared<SymmetricMatrix>(adjacency_matrix_);
+        adjacency_matrix_.clear();
       }
-      file.close();
     } else {
       num_nodes_ = 0;
       num_edges_ = 0;
@@ -68,6 +219,240 @@ EvaluationOracle::EvaluationOracle(string filename, string function_name) {
   }
 }
 
+EvaluationOracle::EvaluationOracle(const EvaluationOracle& parent,
+                                   const vector<int>& ground_set)
+    : num_nodes_(ground_set.size()), num_edges_(parent.num_edges()),
+      function_name_(parent.function_name()), parent_(&parent),
+      ground_set_(ground_set), coverage_error_bound_(0),
+      exact_near_threshold_(false), exact_coverage_(false),
+      query_trace_(nullptr), num_value_queries_(0),
+      num_singleton_queries_(0), num_set_queries_(0),
+      num_exact_reevaluations_(0), generation_(0), singleton_generation_(0) {
+  for (auto u : ground_set_) {
+    assert(0 <= u && u < parent.num_nodes());
+  }
+}
+
+int EvaluationOracle::global_id(int node) const {
+  assert(0 <= node && node < num_nodes_);
+  if (parent_ == nullptr) return node;
+  return parent_->global_id(ground_set_[node]);
+}
+
+void EvaluationOracle::Sparsify(int neighbors, double threshold) {
+  assert(parent_ == nullptr);
+  assert(function_name_ == "image_summarization" ||
+         function_name_ == "movie_recommendation");
+  auto sparse_matrix = std::make_shared<SparseMatrix>(num_nodes_);
+  vector<double> row;
+  for (int i = 0; i < num_nodes_; i++) {
+    SimilarityRow(i, row);
+    sparse_matrix->AddRow(i, row, neighbors, threshold);
+  }
+  sparse_matrix->Finish();
+  vector<vector<double>>().swap(adjacency_matrix_);
+  tiled_matrix_.reset();
+  feature_matrix_.reset();
+  symmetric_matrix_.reset();
+  sparse_matrix_ = sparse_matrix;
+  singleton_values_.clear();
+  generation_++;
+  num_edges_ = sparse_matrix_->num_nonzeros();
+}
+
+void EvaluationOracle::SampleCoverageRows(int sample_size,
+                                          double failure_probability,
+                                          bool exact_near_threshold,
+                                          unsigned seed) {
+  assert(parent_ == nullptr);
+  assert(function_name_ == "image_summarization");
+  sample_rows_.clear();
+  sample_weights_.clear();
+  coverage_error_bound_ = 0;
+  exact_near_threshold_ = false;
+  singleton_values_.clear();
+  generation_++;
+  if (sample_size <= 0) return;
+  assert(0 < failure_probability && failure_probability < 1);
+  // The largest similarity in a row bounds both its coverage and any gain
+  // in it, so with rows drawn proportionally to it every term of the
+  // estimate lies in [0, total_mass].
+  vector<double> mass(num_nodes_), row;
+  double total_mass = 0;
+  for (int i = 0; i < num_nodes_; i++) {
+    SimilarityRow(i, row);
+    for (auto x : row) mass[i] = max(mass[i], x);
+    total_mass += mass[i];
+  }
+  if (total_mass == 0) return;  // Coverage is identically zero
+  std::mt19937 rng(seed);
+  std::discrete_distribution<int> distribution(mass.begin(), mass.end());
+  std::map<int, int> counts;
+  for (int t = 0; t < sample_size; t++) counts[distribution(rng)]++;
+  for (const auto& kv : counts) {
+    sample_rows_.push_back(kv.first);
+    sample_weights_.push_back(
+        kv.second * total_mass / (sample_size * mass[kv.first]));
+  }
+  coverage_error_bound_ =
+      total_mass * sqrt(log(2 / failure_probability) / (2.0 * sample_size));
+  exact_near_threshold_ = exact_near_threshold;
+}
+
+bool EvaluationOracle::sampled() const {
+  if (parent_ != nullptr) return parent_->sampled();
+  return !sample_rows_.empty();
+}
+
+double EvaluationOracle::coverage_error_bound() const {
+  if (parent_ != nullptr) return parent_->coverage_error_bound();
+  return coverage_error_bound_;
+}
+
+long long EvaluationOracle::num_exact_reevaluations() const {
+  if (parent_ != nullptr) return parent_->num_exact_reevaluations();
+  return num_exact_reevaluations_;
+}
+
+bool EvaluationOracle::MarginalAtLeast(double value, double threshold,
+                                       int node, const set<int>& S) const {
+  QueryScratch& scratch = query_scratch;
+  scratch.node.assign(1, node);
+  scratch.value.assign(1, value);
+  MarginalsAtLeast(scratch.node, S, scratch.value, threshold, scratch.above);
+  return scratch.above[0];
+}
+
+void EvaluationOracle::MarginalsAtLeast(const vector<int>& nodes,
+                                        const set<int>& S,
+                                        const vector<double>& values,
+                                        double threshold,
+                                        vector<char>& above) const {
+  assert(nodes.size() == values.size());
+  if (parent_ != nullptr) {
+    vector<int> parent_nodes(nodes.size());
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      assert(0 <= nodes[i] && nodes[i] < num_nodes_);
+      parent_nodes[i] = ground_set_[nodes[i]];
+    }
+    parent_->MarginalsAtLeast(parent_nodes, ToParent(S), values, threshold,
+                              above);
+    return;
+  }
+  above.resize(nodes.size());
+  vector<int> ambiguous, ambiguous_nodes;
+  for (int i = 0; i < (int)nodes.size(); i++) {
+    above[i] = values[i] >= threshold;
+    if (!sample_rows_.empty() && exact_near_threshold_ &&
+        std::fabs(values[i] - threshold) <= coverage_error_bound_) {
+      ambiguous.push_back(i);
+      ambiguous_nodes.push_back(nodes[i]);
+    }
+  }
+  if (ambiguous.empty()) return;
+  num_exact_reevaluations_ += ambiguous.size();
+  vector<double> exact_values;
+  exact_coverage_ = true;
+  MarginalValues(ambiguous_nodes, S, exact_values);
+  exact_coverage_ = false;
+  for (int a = 0; a < (int)ambiguous.size(); a++) {
+    above[ambiguous[a]] = exact_values[a] >= threshold;
+  }
+}
+
+void EvaluationOracle::set_query_trace(QueryTraceWriter* trace) {
+  assert(parent_ == nullptr);
+  query_trace_ = trace;
+}
+
+void EvaluationOracle::TraceQuery(QueryKind kind, const set<int>& S,
+                                  double result, const vector<int>* nodes,
+                                  const vector<set<int>>* sets) const {
+  Query& query = query_scratch.traced_query;
+  query.kind = kind;
+  query.S.assign(S.begin(), S.end());
+  query.nodes.clear();
+  if (nodes != nullptr) query.nodes = *nodes;
+  query.sets.clear();
+  if (sets != nullptr) {
+    for (const auto& T : *sets) query.sets.emplace_back(T.begin(), T.end());
+  }
+  query.result = result;
+  query_trace_->Add(query);
+}
+
+set<int> EvaluationOracle::ToParent(const set<int>& S) const {
+  set<int> parent_S;
+  for (auto u : S) {
+    assert(0 <= u && u < num_nodes_);
+    parent_S.insert(ground_set_[u]);
+  }
+  return parent_S;
+}
+
+double EvaluationOracle::total_query_seconds() {
+  return ::total_query_seconds;
+}
+
+void EvaluationOracle::set_query_timing(bool enabled) {
+  query_timing = enabled;
+}
+
+long long EvaluationOracle::total_io_bytes() {
+  return TiledMatrix::total_bytes_read();
+}
+
+long long EvaluationOracle::total_value_queries() {
+  return ::total_value_queries;
+}
+
+namespace {
+
+OracleCounters CurrentCounters() {
+  return OracleCounters{EvaluationOracle::total_query_seconds(),
+                        EvaluationOracle::total_io_bytes(),
+                        EvaluationOracle::total_value_queries()};
+}
+
+// Results created in a program that links the oracle record its counters.
+const bool counters_registered =
+    (MaximizationResult::set_oracle_counter_source(CurrentCounters), true);
+
+}  // namespace
+
+int EvaluationOracle::num_threads() {
+  if (num_threads_setting > 0) return num_threads_setting;
+  return max(1, (int)std::thread::hardware_concurrency());
+}
+
+void EvaluationOracle::set_num_threads(int num_threads) {
+  num_threads_setting = num_threads;
+}
+
+int EvaluationOracle::BatchWorkers(int batch_size, int min_per_thread) const {
+  if (tiled_matrix_ || in_batch_worker) return 1;  // Tiles are not thread-safe
+  int num_workers =
+      std::min(num_threads(), max(1, batch_size / min_per_thread));
+  // A batch that cannot keep every thread busy on a large oracle is better
+  // served one query at a time, each split over its rows.
+  if (num_workers < num_threads() && num_nodes_ >= kMinNodesForRowBlocks) {
+    return 1;
+  }
+  return num_workers;
+}
+
+int EvaluationOracle::RowWorkers(long long entries) const {
+  if (tiled_matrix_ || in_batch_worker) return 1;
+  if (num_nodes_ < kMinNodesForRowBlocks) return 1;
+  return (int)std::min<long long>(num_threads(),
+                                  max(1LL, entries / kMinEntriesPerThread));
+}
+
+bool EvaluationOracle::BlockedCoverage() const {
+  return num_nodes_ >= kMinNodesForRowBlocks && !tiled_matrix_ &&
+         !sparse_matrix_ && (sample_rows_.empty() || exact_coverage_);
+}
+
 const vector<pair<int, double>>& EvaluationOracle::OutgoingEdges(
     int node) const {
   assert(0 <= node && node < num_nodes_);
@@ -81,17 +466,50 @@ const vector<pair<int, double>>& EvaluationOracle::IncomingEdges(
 }
 
 double EvaluationOracle::Value(const set<int>& S) const {
-  if (function_name_ == "graph_cut") return GraphCutValue(S);
-  if (function_name_ == "image_summarization")
-    return ImageSummarizationValue(S);
-  if (function_name_ == "movie_recommendation")
-    return MovieRecommendationValue(S);
-  if (function_name_ == "revenue") return RevenueValue(S);
-  assert(false); return 0;
+  if (parent_ != nullptr) {
+    num_value_queries_++;
+    return parent_->Value(ToParent(S));
+  }
+  PROFILE_HOT_SCOPE("EvaluationOracle::Value");
+  num_value_queries_++;
+  ::total_value_queries++;
+  QueryTimer timer;
+  double value = 0;
+  if (function_name_ == "graph_cut") {
+    value = GraphCutValue(S);
+  } else if (function_name_ == "image_summarization") {
+    value = ImageSummarizationValue(S);
+  } else if (function_name_ == "movie_recommendation") {
+    value = MovieRecommendationValue(S);
+  } else if (function_name_ == "revenue") {
+    value = RevenueValue(S);
+  } else {
+    assert(false);
+  }
+  if (query_trace_ != nullptr) TraceQuery(QueryKind::kValue, S, value);
+  return value;
 }
 
 double EvaluationOracle::MarginalValue(int node,
                                        const set<int>& S) const {
+  if (parent_ != nullptr) {
+    num_singleton_queries_++;
+    assert(0 <= node && node < num_nodes_);
+    return parent_->MarginalValue(ground_set_[node], ToParent(S));
+  }
+  PROFILE_HOT_SCOPE("EvaluationOracle::MarginalValue(node)");
+  num_singleton_queries_++;
+  QueryTimer timer;
+  double value = SingletonMarginalValue(node, S);
+  if (query_trace_ != nullptr) {
+    vector<int> nodes(1, node);
+    TraceQuery(QueryKind::kMarginal, S, value, &nodes);
+  }
+  return value;
+}
+
+double EvaluationOracle::SingletonMarginalValue(int node,
+                                                const set<int>& S) const {
   if (function_name_ == "graph_cut")
     return GraphCutMarginalValue(node, S);
   if (function_name_ == "image_summarization")
@@ -102,15 +520,187 @@ double EvaluationOracle::MarginalValue(int node,
   assert(false); return 0;
 }
 
+void EvaluationOracle::MarginalValues(const vector<int>& nodes,
+                                      const set<int>& S,
+                                      vector<double>& values) const {
+  if (parent_ != nullptr) {
+    num_singleton_queries_ += nodes.size();
+    vector<int> parent_nodes(nodes.size());
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      assert(0 <= nodes[i] && nodes[i] < num_nodes_);
+      parent_nodes[i] = ground_set_[nodes[i]];
+    }
+    parent_->MarginalValues(parent_nodes, ToParent(S), values);
+    return;
+  }
+  PROFILE_HOT_SCOPE("EvaluationOracle::MarginalValues");
+  num_singleton_queries_ += nodes.size();
+  QueryTimer timer;
+  values.resize(nodes.size());
+  if (function_name_ == "image_summarization") {
+    ImageSummarizationMarginalValues(nodes, S, values);
+  } else if (function_name_ == "movie_recommendation") {
+    MovieRecommendationMarginalValues(nodes, S, values);
+  } else {
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      values[i] = SingletonMarginalValue(nodes[i], S);
+    }
+  }
+  if (query_trace_ != nullptr) {
+    double sum = 0;
+    for (auto value : values) sum += value;
+    TraceQuery(QueryKind::kMarginals, S, sum, &nodes);
+  }
+}
+
+const vector<double>& EvaluationOracle::SingletonValues() const {
+  if (parent_ != nullptr) {
+    // The copy is redone after the root changes its backend.
+    const EvaluationOracle* root = parent_;
+    while (root->parent_ != nullptr) root = root->parent_;
+    if ((int)singleton_values_.size() == num_nodes_ &&
+        singleton_generation_ == root->generation_) {
+      return singleton_values_;
+    }
+    const vector<double>& parent_values = parent_->SingletonValues();
+    singleton_values_.resize(num_nodes_);
+    for (int i = 0; i < num_nodes_; i++) {
+      singleton_values_[i] = parent_values[ground_set_[i]];
+    }
+    singleton_generation_ = root->generation_;
+    return singleton_values_;
+  }
+  if ((int)singleton_values_.size() == num_nodes_) return singleton_values_;
+  PROFILE_SCOPE("EvaluationOracle::SingletonValues");
+  num_singleton_queries_ += num_nodes_;
+  QueryTimer timer;
+  // Each thread evaluates a contiguous range of nodes against the empty set
+  // with the unprofiled kernels, so every value is the one MarginalValues
+  // returns, unless BatchWorkers leaves the rows of each query to split.
+  int num_workers = BatchWorkers(num_nodes_, kMinNodesPerThread);
+  vector<double> values(num_nodes_);
+  auto evaluate_range = [&](int begin, int end) {
+    BatchWorkerScope scope(num_workers > 1);
+    set<int> empty_set;
+    vector<int> nodes;
+    for (int u = begin; u < end; u++) nodes.push_back(u);
+    vector<double> range_values(nodes.size());
+    if (function_name_ == "image_summarization") {
+      ImageSummarizationMarginalValues(nodes, empty_set, range_values);
+    } else if (function_name_ == "movie_recommendation") {
+      MovieRecommendationMarginalValues(nodes, empty_set, range_values);
+    } else {
+      for (int i = 0; i < (int)nodes.size(); i++) {
+        range_values[i] = SingletonMarginalValue(nodes[i], empty_set);
+      }
+    }
+    std::copy(range_values.begin(), range_values.end(), values.begin() + begin);
+  };
+  ParallelRows(num_nodes_, num_workers, evaluate_range);
+  singleton_values_.swap(values);
+  if (query_trace_ != nullptr) {
+    double sum = 0;
+    for (auto value : singleton_values_) sum += value;
+    TraceQuery(QueryKind::kSingletons, set<int>(), sum);
+  }
+  return singleton_values_;
+}
+
 double EvaluationOracle::MarginalValue(const set<int>& T,
                                        const set<int>& S) const {
-  if (function_name_ == "graph_cut") return GraphCutMarginalValue(T, S);
-  if (function_name_ == "image_summarization")
-    return ImageSummarizationMarginalValue(T, S);
-  if (function_name_ == "movie_recommendation")
-    return MovieRecommendationMarginalValue(T, S);
-  if (function_name_ == "revenue") return RevenueMarginalValue(T, S);
-  assert(false); return 0;
+  if (parent_ != nullptr) {
+    num_set_queries_++;
+    return parent_->MarginalValue(ToParent(T), ToParent(S));
+  }
+  PROFILE_HOT_SCOPE("EvaluationOracle::MarginalValue(set)");
+  num_set_queries_++;
+  QueryTimer timer;
+  double value = 0;
+  if (function_name_ == "graph_cut") {
+    value = GraphCutMarginalValue(T, S);
+  } else if (function_name_ == "image_summarization") {
+    value = ImageSummarizationMarginalValue(T, S);
+  } else if (function_name_ == "movie_recommendation") {
+    value = MovieRecommendationMarginalValue(T, S);
+  } else if (function_name_ == "revenue") {
+    value = RevenueMarginalValue(T, S);
+  } else {
+    assert(false);
+  }
+  if (query_trace_ != nullptr) {
+    vector<set<int>> sets(1, T);
+    TraceQuery(QueryKind::kSetMarginal, S, value, nullptr, &sets);
+  }
+  return value;
+}
+
+void EvaluationOracle::MarginalValues(const vector<set<int>>& sets,
+                                      const set<int>& S,
+                                      vector<double>& values) const {
+  if (parent_ != nullptr) {
+    num_set_queries_ += sets.size();
+    vector<set<int>> parent_sets;
+    parent_sets.reserve(sets.size());
+    for (const auto& T : sets) parent_sets.push_back(ToParent(T));
+    parent_->MarginalValues(parent_sets, ToParent(S), values);
+    return;
+  }
+  PROFILE_HOT_SCOPE("EvaluationOracle::MarginalValues(sets)");
+  num_set_queries_ += sets.size();
+  QueryTimer timer;
+  values.assign(sets.size(), 0);
+  if (sets.empty()) return;
+  // The state of S, which the workers only read.
+  vector<int> S_members(S.begin(), S.end());
+  vector<double> row_maxima;
+  double S_value = 0;
+  if (function_name_ == "image_summarization") {
+    row_maxima.assign(num_nodes_, 0);
+    CoverRows(S_members, row_maxima);
+  } else if (function_name_ == "revenue") {
+    S_value = RevenueValue(S);
+  }
+  // Each thread evaluates a contiguous range of sets with the same sums, in
+  // the same order, as MarginalValue(T, S), unless BatchWorkers leaves the
+  // rows of each query to split.
+  int num_workers = BatchWorkers(sets.size(), kMinSetsPerThread);
+  auto evaluate_range = [&](int begin, int end) {
+    BatchWorkerScope scope(num_workers > 1);
+    if (function_name_ == "image_summarization") {
+      vector<vector<int>> members(end - begin);
+      for (int t = begin; t < end; t++) {
+        members[t - begin].assign(sets[t].begin(), sets[t].end());
+      }
+      vector<double> coverage;
+      SetCoverageGains(row_maxima, members, coverage);
+      assert(num_nodes_ > 0);
+      for (int t = begin; t < end; t++) {
+        const vector<int>& T_members = members[t - begin];
+        double diversity = CrossSum(S_members, T_members) +
+                           SubmatrixSum(T_members, T_members);
+        values[t] = coverage[t - begin] - diversity/num_nodes_;
+      }
+      return;
+    }
+    for (int t = begin; t < end; t++) {
+      if (function_name_ == "graph_cut") {
+        values[t] = GraphCutMarginalValue(sets[t], S);
+      } else if (function_name_ == "movie_recommendation") {
+        values[t] = MovieRecommendationMarginalValue(sets[t], S);
+      } else {
+        set<int>& query_set = query_scratch.query_set;
+        query_set = S;
+        query_set.insert(sets[t].begin(), sets[t].end());
+        values[t] = RevenueValue(query_set) - S_value;
+      }
+    }
+  };
+  ParallelRows(sets.size(), num_workers, evaluate_range);
+  if (query_trace_ != nullptr) {
+    double sum = 0;
+    for (auto value : values) sum += value;
+    TraceQuery(QueryKind::kSetMarginals, S, sum, nullptr, &sets);
+  }
 }
 
 // Graph Cuts ------------------------------------------------------------------ 
@@ -155,23 +745,733 @@ double EvaluationOracle::GraphCutMarginalValue(const set<int>& T,
   return value;
 }
 
-// Image Summarization --------------------------------------------------------- 
-double EvaluationOracle::ImageSummarizationValue(const set<int>& S) const {
-  if (S.size() == 0) return 0;
-  double coverage = 0;
+// Similarity Kernels ----------------------------------------------------------
+double EvaluationOracle::Similarity(int i, int j) const {
+  if (tiled_matrix_) return tiled_matrix_->At(i, j);
+  if (feature_matrix_) return feature_matrix_->Similarity(i, j);
+  if (sparse_matrix_) return sparse_matrix_->At(i, j);
+  if (symmetric_matrix_) return symmetric_matrix_->At(i, j);
+  return adjacency_matrix_[i][j];
+}
+
+void EvaluationOracle::SimilarityRow(int i, vector<double>& row) const {
+  assert(0 <= i && i < num_nodes_);
+  row.assign(num_nodes_, 0);
+  if (tiled_matrix_) {
+    const int B = tiled_matrix_->tile_size();
+    for (int tile_column = 0; tile_column < tiled_matrix_->num_tiles();
+         tile_column++) {
+      const double* tile = tiled_matrix_->Tile(i / B, tile_column) +
+                           (i % B) * B;
+      int column_begin = tile_column * B;
+      int column_end = std::min(num_nodes_, column_begin + B);
+      for (int j = column_begin; j < column_end; j++) {
+        row[j] = tile[j - column_begin];
+      }
+    }
+    return;
+  }
+  if (feature_matrix_) {
+    vector<int> all(num_nodes_);
+    for (int j = 0; j < num_nodes_; j++) all[j] = j;
+    feature_matrix_->SimilarityBlock(vector<int>(1, i), all, row);
+    return;
+  }
+  if (sparse_matrix_) {
+    const int* columns = sparse_matrix_->RowIndices(i);
+    const double* values = sparse_matrix_->RowValues(i);
+    for (int p = 0; p < sparse_matrix_->RowSize(i); p++) {
+      row[columns[p]] = values[p];
+    }
+    return;
+  }
+  if (symmetric_matrix_) {
+    for (int j = 0; j < i; j++) row[j] = symmetric_matrix_->UpperRow(j)[i];
+    const double* upper_row = symmetric_matrix_->UpperRow(i);
+    for (int j = i; j < num_nodes_; j++) row[j] = upper_row[j];
+    return;
+  }
+  row = adjacency_matrix_[i];
+}
+
+void EvaluationOracle::CoverRows(const vector<int>& columns,
+                                 vector<double>& row_maxima) const {
+  assert((int)row_maxima.size() == num_nodes_);
+  if (columns.empty()) return;
+  if (!sample_rows_.empty() && !exact_coverage_) {
+    // Only the sampled rows are read.
+    if (feature_matrix_) {
+      const int B = FeatureMatrix::kBlockSize;
+      vector<int> chunk;
+      vector<double> block;
+      for (int c0 = 0; c0 < (int)columns.size(); c0 += B) {
+        chunk.assign(columns.begin() + c0,
+                     columns.begin() + std::min((int)columns.size(), c0 + B));
+        feature_matrix_->SimilarityBlock(sample_rows_, chunk, block);
+        for (int r = 0; r < (int)sample_rows_.size(); r++) {
+          double max_similarity = row_maxima[sample_rows_[r]];
+          for (int c = 0; c < (int)chunk.size(); c++) {
+            max_similarity = max(max_similarity, block[r * chunk.size() + c]);
+          }
+          row_maxima[sample_rows_[r]] = max_similarity;
+        }
+      }
+      return;
+    }
+    for (auto i : sample_rows_) {
+      double max_similarity = row_maxima[i];
+      for (auto j : columns) {
+        max_similarity = max(max_similarity, Similarity(i, j));
+      }
+      row_maxima[i] = max_similarity;
+    }
+    return;
+  }
+  if (tiled_matrix_) {
+    // Visits the tiles holding the columns one block of rows at a time.
+    const int B = tiled_matrix_->tile_size();
+    vector<int> sorted_columns(columns);
+    sort(sorted_columns.begin(), sorted_columns.end());
+    for (int tile_row = 0; tile_row < tiled_matrix_->num_tiles(); tile_row++) {
+      int row_begin = tile_row * B;
+      int row_end = std::min(num_nodes_, row_begin + B);
+      for (int c = 0; c < (int)sorted_columns.size(); ) {
+        int tile_column = sorted_columns[c] / B;
+        const double* tile = tiled_matrix_->Tile(tile_row, tile_column);
+        int c_end = c;
+        while (c_end < (int)sorted_columns.size() &&
+               sorted_columns[c_end] / B == tile_column) c_end++;
+        for (int i = row_begin; i < row_end; i++) {
+          const double* tile_row_data = tile + (i - row_begin) * B;
+          double max_similarity = row_maxima[i];
+          for (int t = c; t < c_end; t++) {
+            max_similarity = max(max_similarity,
+                                 tile_row_data[sorted_columns[t] % B]);
+          }
+          row_maxima[i] = max_similarity;
+        }
+        c = c_end;
+      }
+    }
+    return;
+  }
+  if (sparse_matrix_) {
+    // Rows missing from a column have similarity 0 <= row_maxima[i].
+    for (auto j : columns) {
+      const int* rows = sparse_matrix_->ColumnIndices(j);
+      const double* values = sparse_matrix_->ColumnValues(j);
+      for (int p = 0; p < sparse_matrix_->ColumnSize(j); p++) {
+        row_maxima[rows[p]] = max(row_maxima[rows[p]], values[p]);
+      }
+    }
+    return;
+  }
+  int num_workers = RowWorkers((long long)num_nodes_ * columns.size());
+  ParallelRows(num_nodes_, num_workers, [&](int begin, int end) {
+    CoverRowRange(columns, row_maxima, begin, end);
+  });
+}
+
+void EvaluationOracle::CoverRowRange(const vector<int>& columns,
+                                     vector<double>& row_maxima, int begin,
+                                     int end) const {
+  if (feature_matrix_) {
+    const int B = FeatureMatrix::kBlockSize;
+    vector<int> rows, chunk;
+    vector<double> block;
+    for (int c0 = 0; c0 < (int)columns.size(); c0 += B) {
+      chunk.assign(columns.begin() + c0,
+                   columns.begin() + std::min((int)columns.size(), c0 + B));
+      for (int i0 = begin; i0 < end; i0 += B) {
+        rows.clear();
+        for (int i = i0; i < std::min(end, i0 + B); i++) {
+          rows.push_back(i);
+        }
+        feature_matrix_->SimilarityBlock(rows, chunk, block);
+        for (int r = 0; r < (int)rows.size(); r++) {
+          double max_similarity = row_maxima[rows[r]];
+          for (int c = 0; c < (int)chunk.size(); c++) {
+            max_similarity = max(max_similarity, block[r * chunk.size() + c]);
+          }
+          row_maxima[rows[r]] = max_similarity;
+        }
+      }
+    }
+    return;
+  }
+  if (symmetric_matrix_) {
+    // Column j is row j, which holds rows i >= j contiguously.
+    for (auto j : columns) {
+      const double* upper_row = symmetric_matrix_->UpperRow(j);
+      for (int i = begin; i < std::min(j, end); i++) {
+        row_maxima[i] = max(row_maxima[i], symmetric_matrix_->UpperRow(i)[j]);
+      }
+      for (int i = max(j, begin); i < end; i++) {
+        row_maxima[i] = max(row_maxima[i], upper_row[i]);
+      }
+    }
+    return;
+  }
+  for (int i = begin; i < end; i++) {
+    const vector<double>& row = adjacency_matrix_[i];
+    double max_similarity = row_maxima[i];
+    for (auto j : columns) {
+      max_similarity = max(max_similarity, row[j]);
+    }
+    row_maxima[i] = max_similarity;
+  }
+}
+
+void EvaluationOracle::CoverageGains(const vector<double>& row_maxima,
+                                     const vector<int>& candidates,
+                                     vector<double>& gains) const {
+  assert((int)row_maxima.size() == num_nodes_);
+  gains.assign(candidates.size(), 0);
+  if (candidates.empty()) return;
+  if (!sample_rows_.empty() && !exact_coverage_) {
+    // Each gain is a weighted sum over the sampled rows in increasing order.
+    if (feature_matrix_) {
+      const int B = FeatureMatrix::kBlockSize;
+      vector<int> chunk;
+      vector<double> block;
+      for (int c0 = 0; c0 < (int)candidates.size(); c0 += B) {
+        int c1 = std::min((int)candidates.size(), c0 + B);
+        chunk.assign(candidates.begin() + c0, candidates.begin() + c1);
+        feature_matrix_->SimilarityBlock(sample_rows_, chunk, block);
+        for (int r = 0; r < (int)sample_rows_.size(); r++) {
+          double max_similarity = row_maxima[sample_rows_[r]];
+          double weight = sample_weights_[r];
+          for (int c = c0; c < c1; c++) {
+            double new_max_similarity =
+                max(max_similarity, block[r * chunk.size() + c - c0]);
+            gains[c] += weight * (new_max_similarity - max_similarity);
+          }
+        }
+      }
+      return;
+    }
+    for (int r = 0; r < (int)sample_rows_.size(); r++) {
+      int i = sample_rows_[r];
+      double max_similarity = row_maxima[i];
+      for (int c = 0; c < (int)candidates.size(); c++) {
+        double new_max_similarity =
+            max(max_similarity, Similarity(i, candidates[c]));
+        gains[c] += sample_weights_[r] * (new_max_similarity - max_similarity);
+      }
+    }
+    return;
+  }
+  if (tiled_matrix_) {
+    // Candidates are grouped by tile column so that every tile in the
+    // union of their columns is loaded once per batch. Rows are still
+    // visited in increasing order, so the sums match the dense kernel.
+    const int B = tiled_matrix_->tile_size();
+    vector<int> order(candidates.size());
+    for (int c = 0; c < (int)order.size(); c++) order[c] = c;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+      return candidates[a] < candidates[b];
+    });
+    for (int tile_row = 0; tile_row < tiled_matrix_->num_tiles(); tile_row++) {
+      int row_begin = tile_row * B;
+      int row_end = std::min(num_nodes_, row_begin + B);
+      for (int c = 0; c < (int)order.size(); ) {
+        int tile_column = candidates[order[c]] / B;
+        const double* tile = tiled_matrix_->Tile(tile_row, tile_column);
+        int c_end = c;
+        while (c_end < (int)order.size() &&
+               candidates[order[c_end]] / B == tile_column) c_end++;
+        for (int i = row_begin; i < row_end; i++) {
+          const double* tile_row_data = tile + (i - row_begin) * B;
+          double max_similarity = row_maxima[i];
+          for (int t = c; t < c_end; t++) {
+            double new_max_similarity = max(max_similarity,
+                tile_row_data[candidates[order[t]] % B]);
+            gains[order[t]] += new_max_similarity - max_similarity;
+          }
+        }
+        c = c_end;
+      }
+    }
+    return;
+  }
+  if (sparse_matrix_) {
+    for (int c = 0; c < (int)candidates.size(); c++) {
+      const int* rows = sparse_matrix_->ColumnIndices(candidates[c]);
+      const double* values = sparse_matrix_->ColumnValues(candidates[c]);
+      double gain = 0;
+      for (int p = 0; p < sparse_matrix_->ColumnSize(candidates[c]); p++) {
+        double max_similarity = row_maxima[rows[p]];
+        gain += max(max_similarity, values[p]) - max_similarity;
+      }
+      gains[c] = gain;
+    }
+    return;
+  }
+  if (!BlockedCoverage()) {
+    CoverageGainRange(row_maxima, candidates, 0, num_nodes_, gains);
+    return;
+  }
+  int num_workers = RowWorkers((long long)num_nodes_ * candidates.size());
+  BlockedRowSums(num_nodes_, num_workers, gains,
+                 [&](int begin, int end, vector<double>& partial) {
+    CoverageGainRange(row_maxima, candidates, begin, end, partial);
+  });
+}
+
+void EvaluationOracle::CoverageGainRange(const vector<double>& row_maxima,
+                                         const vector<int>& candidates,
+                                         int begin, int end,
+                                         vector<double>& gains) const {
+  if (feature_matrix_) {
+    // Each column is still summed over the rows in increasing order.
+    const int B = FeatureMatrix::kBlockSize;
+    vector<int> rows, chunk;
+    vector<double> block;
+    for (int c0 = 0; c0 < (int)candidates.size(); c0 += B) {
+      int c1 = std::min((int)candidates.size(), c0 + B);
+      chunk.assign(candidates.begin() + c0, candidates.begin() + c1);
+      for (int i0 = begin; i0 < end; i0 += B) {
+        rows.clear();
+        for (int i = i0; i < std::min(end, i0 + B); i++) {
+          rows.push_back(i);
+        }
+        feature_matrix_->SimilarityBlock(rows, chunk, block);
+        for (int r = 0; r < (int)rows.size(); r++) {
+          double max_similarity = row_maxima[rows[r]];
+          const double* block_row = &block[r * chunk.size()];
+          for (int c = c0; c < c1; c++) {
+            double new_max_similarity =
+                max(max_similarity, block_row[c - c0]);
+            gains[c] += new_max_similarity - max_similarity;
+          }
+        }
+      }
+    }
+    return;
+  }
+  if (symmetric_matrix_) {
+    // Entry (i, j) is in row min(i, j). Rows are visited in blocks of one
+    // cache line of each candidate's own row, in increasing order, so the
+    // sums match the dense kernel.
+    const int kRowBlock = 8;
+    vector<const double*> candidate_rows(candidates.size());
+    for (int c = 0; c < (int)candidates.size(); c++) {
+      candidate_rows[c] = symmetric_matrix_->UpperRow(candidates[c]);
+    }
+    const double* upper_rows[kRowBlock];
+    for (int i0 = begin; i0 < end; i0 += kRowBlock) {
+      int i1 = std::min(end, i0 + kRowBlock);
+      for (int i = i0; i < i1; i++) {
+        upper_rows[i - i0] = symmetric_matrix_->UpperRow(i);
+      }
+      for (int c = 0; c < (int)candidates.size(); c++) {
+        int j = candidates[c];
+        double gain = gains[c];
+        for (int i = i0; i < i1; i++) {
+          double similarity =
+              j < i ? candidate_rows[c][i] : upper_rows[i - i0][j];
+          double max_similarity = row_maxima[i];
+          gain += max(max_similarity, similarity) - max_similarity;
+        }
+        gains[c] = gain;
+      }
+    }
+    return;
+  }
+  for (int i = begin; i < end; i++) {
+    const vector<double>& row = adjacency_matrix_[i];
+    double max_similarity = row_maxima[i];
+    for (int c = 0; c < (int)candidates.size(); c++) {
+      double new_max_similarity = max(max_similarity, row[candidates[c]]);
+      gains[c] += new_max_similarity - max_similarity;
+    }
+  }
+}
+
+void EvaluationOracle::SetCoverageGains(const vector<double>& row_maxima,
+                                        const vector<vector<int>>& sets,
+                                        vector<double>& gains) const {
+  assert((int)row_maxima.size() == num_nodes_);
+  gains.assign(sets.size(), 0);
+  if (sets.empty()) return;
+  bool all_rows = sample_rows_.empty() || exact_coverage_;
+  if (all_rows && (!adjacency_matrix_.empty() || symmetric_matrix_)) {
+    if (!BlockedCoverage()) {
+      SetCoverageGainRange(row_maxima, sets, 0, num_nodes_, gains);
+      return;
+    }
+    long long entries = 0;
+    for (const auto& T : sets) entries += (long long)num_nodes_ * T.size();
+    BlockedRowSums(num_nodes_, RowWorkers(entries), gains,
+                   [&](int begin, int end, vector<double>& partial) {
+      SetCoverageGainRange(row_maxima, sets, begin, end, partial);
+    });
+    return;
+  }
+  vector<double> new_row_maxima;
+  for (int t = 0; t < (int)sets.size(); t++) {
+    new_row_maxima = row_maxima;
+    CoverRows(sets[t], new_row_maxima);
+    gains[t] = CoverageSum(new_row_maxima, row_maxima);
+  }
+}
+
+void EvaluationOracle::SetCoverageGainRange(
+    const vector<double>& row_maxima, const vector<vector<int>>& sets,
+    int begin, int end, vector<double>& gains) const {
+  if (symmetric_matrix_) {
+    // Entry (i, j) is in row min(i, j). Rows are visited in blocks of one
+    // cache line of row j, as in CoverageGains.
+    const int kRowBlock = 8;
+    const double* upper_rows[kRowBlock];
+    double new_row_maxima[kRowBlock];
+    for (int i0 = begin; i0 < end; i0 += kRowBlock) {
+      int i1 = std::min(end, i0 + kRowBlock);
+      for (int i = i0; i < i1; i++) {
+        upper_rows[i - i0] = symmetric_matrix_->UpperRow(i);
+      }
+      for (int t = 0; t < (int)sets.size(); t++) {
+        for (int i = i0; i < i1; i++) new_row_maxima[i - i0] = row_maxima[i];
+        for (auto j : sets[t]) {
+          const double* column = symmetric_matrix_->UpperRow(j);
+          for (int i = i0; i < i1; i++) {
+            double similarity = j < i ? column[i] : upper_rows[i - i0][j];
+            new_row_maxima[i - i0] = max(new_row_maxima[i - i0], similarity);
+          }
+        }
+        double gain = gains[t];
+        for (int i = i0; i < i1; i++) {
+          gain += new_row_maxima[i - i0] - row_maxima[i];
+        }
+        gains[t] = gain;
+      }
+    }
+    return;
+  }
+  for (int i = begin; i < end; i++) {
+    const vector<double>& row = adjacency_matrix_[i];
+    double max_similarity = row_maxima[i];
+    for (int t = 0; t < (int)sets.size(); t++) {
+      double new_max_similarity = max_similarity;
+      for (auto j : sets[t]) {
+        new_max_similarity = max(new_max_similarity, row[j]);
+      }
+      gains[t] += new_max_similarity - max_similarity;
+    }
+  }
+}
+
+void EvaluationOracle::PairSums(const vector<int>& members,
+                                const vector<int>& candidates,
+                                vector<double>& sums) const {
+  sums.assign(candidates.size(), 0);
+  if (members.empty() || candidates.empty()) return;
+  if (tiled_matrix_) {
+    // Gathers both entries of every pair for one tile column of candidates
+    // at a time, loading each tile in their rows and columns once, and then
+    // adds them up in the same order as the dense kernel.
+    const int B = tiled_matrix_->tile_size();
+    const int m = members.size();
+    vector<int> order(candidates.size());
+    for (int c = 0; c < (int)order.size(); c++) order[c] = c;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+      return candidates[a] < candidates[b];
+    });
+    vector<int> member_order(m);
+    for (int k = 0; k < m; k++) member_order[k] = k;
+    sort(member_order.begin(), member_order.end(), [&](int a, int b) {
+      return members[a] < members[b];
+    });
+    vector<double> forward, backward;  // Entries (j, c) and (c, j)
+    for (int c = 0; c < (int)order.size(); ) {
+      int block = candidates[order[c]] / B;
+      int c_end = c;
+      while (c_end < (int)order.size() &&
+             candidates[order[c_end]] / B == block) c_end++;
+      forward.assign((c_end - c) * m, 0);
+      backward.assign((c_end - c) * m, 0);
+      for (int k = 0; k < m; ) {
+        int member_block = members[member_order[k]] / B;
+        int k_end = k;
+        while (k_end < m && members[member_order[k_end]] / B == member_block) {
+          k_end++;
+        }
+        const double* tile = tiled_matrix_->Tile(member_block, block);
+        for (int t = k; t < k_end; t++) {
+          const double* row = tile + (members[member_order[t]] % B) * B;
+          for (int u = c; u < c_end; u++) {
+            forward[(u - c) * m + member_order[t]] =
+                row[candidates[order[u]] % B];
+          }
+        }
+        tile = tiled_matrix_->Tile(block, member_block);
+        for (int u = c; u < c_end; u++) {
+          const double* row = tile + (candidates[order[u]] % B) * B;
+          for (int t = k; t < k_end; t++) {
+            backward[(u - c) * m + member_order[t]] =
+                row[members[member_order[t]] % B];
+          }
+        }
+        k = k_end;
+      }
+      for (int u = c; u < c_end; u++) {
+        double sum = 0;
+        for (int k = 0; k < m; k++) {
+          sum += forward[(u - c) * m + k];
+          sum += backward[(u - c) * m + k];
+        }
+        sums[order[u]] = sum;
+      }
+      c = c_end;
+    }
+    return;
+  }
+  if (feature_matrix_) {
+    // The kernels are symmetric, so one block holds both entries of a pair.
+    const int B = FeatureMatrix::kBlockSize;
+    vector<int> chunk;
+    vector<double> block;
+    for (int c0 = 0; c0 < (int)candidates.size(); c0 += B) {
+      int c1 = std::min((int)candidates.size(), c0 + B);
+      chunk.assign(candidates.begin() + c0, candidates.begin() + c1);
+      feature_matrix_->SimilarityBlock(chunk, members, block);
+      for (int c = c0; c < c1; c++) {
+        const double* block_row = &block[(c - c0) * members.size()];
+        double sum = 0;
+        for (int k = 0; k < (int)members.size(); k++) {
+          sum += block_row[k];
+          sum += block_row[k];
+        }
+        sums[c] = sum;
+      }
+    }
+    return;
+  }
+  if (sparse_matrix_) {
+    for (int c = 0; c < (int)candidates.size(); c++) {
+      double sum = 0;
+      for (auto j : members) {
+        sum += sparse_matrix_->At(j, candidates[c]);
+        sum += sparse_matrix_->At(candidates[c], j);
+      }
+      sums[c] = sum;
+    }
+    return;
+  }
+  if (symmetric_matrix_) {
+    // Both entries of a pair are equal, so each pair is read once.
+    for (int c = 0; c < (int)candidates.size(); c++) {
+      double sum = 0;
+      for (auto j : members) {
+        double similarity = symmetric_matrix_->At(j, candidates[c]);
+        sum += similarity;
+        sum += similarity;
+      }
+      sums[c] = sum;
+    }
+    return;
+  }
+  for (int c = 0; c < (int)candidates.size(); c++) {
+    int node = candidates[c];
+    double sum = 0;
+    for (auto j : members) {
+      sum += adjacency_matrix_[j][node];
+      sum += adjacency_matrix_[node][j];
+    }
+    sums[c] = sum;
+  }
+}
+
+double EvaluationOracle::SubmatrixSum(const vector<int>& rows,
+                                      const vector<int>& columns) const {
+  double sum = 0;
+  if (tiled_matrix_) {
+    // Loads each tile that meets the submatrix once.
+    const int B = tiled_matrix_->tile_size();
+    vector<int> sorted_rows(rows), sorted_columns(columns);
+    sort(sorted_rows.begin(), sorted_rows.end());
+    sort(sorted_columns.begin(), sorted_columns.end());
+    for (int r = 0; r < (int)sorted_rows.size(); ) {
+      int row_block = sorted_rows[r] / B;
+      int r_end = r;
+      while (r_end < (int)sorted_rows.size() &&
+             sorted_rows[r_end] / B == row_block) r_end++;
+      for (int c = 0; c < (int)sorted_columns.size(); ) {
+        int column_block = sorted_columns[c] / B;
+        int c_end = c;
+        while (c_end < (int)sorted_columns.size() &&
+               sorted_columns[c_end] / B == column_block) c_end++;
+        const double* tile = tiled_matrix_->Tile(row_block, column_block);
+        for (int t = r; t < r_end; t++) {
+          const double* row = tile + (sorted_rows[t] % B) * B;
+          for (int u = c; u < c_end; u++) sum += row[sorted_columns[u] % B];
+        }
+        c = c_end;
+      }
+      r = r_end;
+    }
+    return sum;
+  }
+  if (feature_matrix_) {
+    const int B = FeatureMatrix::kBlockSize;
+    vector<int> row_chunk, column_chunk;
+    vector<double> block;
+    for (int r0 = 0; r0 < (int)rows.size(); r0 += B) {
+      row_chunk.assign(rows.begin() + r0,
+                       rows.begin() + std::min((int)rows.size(), r0 + B));
+      for (int c0 = 0; c0 < (int)columns.size(); c0 += B) {
+        column_chunk.assign(columns.begin() + c0,
+            columns.begin() + std::min((int)columns.size(), c0 + B));
+        feature_matrix_->SimilarityBlock(row_chunk, column_chunk, block);
+        for (auto x : block) sum += x;
+      }
+    }
+    return sum;
+  }
+  if (sparse_matrix_) {
+    // Intersects each sorted row with the sorted columns.
+    vector<int> sorted_columns(columns);
+    sort(sorted_columns.begin(), sorted_columns.end());
+    for (auto i : rows) {
+      const int* row_columns = sparse_matrix_->RowIndices(i);
+      const double* values = sparse_matrix_->RowValues(i);
+      int p = 0, q = 0;
+      while (p < sparse_matrix_->RowSize(i) && q < (int)sorted_columns.size()) {
+        if (row_columns[p] < sorted_columns[q]) {
+          p++;
+        } else if (sorted_columns[q] < row_columns[p]) {
+          q++;
+        } else {
+          sum += values[p];
+          q++;  // Repeated columns are counted again
+        }
+      }
+    }
+    return sum;
+  }
+  if (symmetric_matrix_) {
+    if (rows == columns) {
+      // Each pair off the diagonal is read once and counted twice.
+      for (int r = 0; r < (int)rows.size(); r++) {
+        sum += symmetric_matrix_->At(rows[r], rows[r]);
+        for (int c = r + 1; c < (int)columns.size(); c++) {
+          sum += 2 * symmetric_matrix_->At(rows[r], columns[c]);
+        }
+      }
+      return sum;
+    }
+    for (auto i : rows) {
+      for (auto j : columns) sum += symmetric_matrix_->At(i, j);
+    }
+    return sum;
+  }
+  for (auto i : rows) {
+    for (auto j : columns) {
+      sum += adjacency_matrix_[i][j];
+    }
+  }
+  return sum;
+}
+
+double EvaluationOracle::CrossSum(const vector<int>& rows,
+                                  const vector<int>& columns) const {
+  if (symmetric_matrix_) return 2 * SubmatrixSum(rows, columns);
+  return SubmatrixSum(rows, columns) + SubmatrixSum(columns, rows);
+}
+
+void EvaluationOracle::ColumnSums(const vector<int>& columns,
+                                  vector<double>& sums) const {
+  sums.assign(columns.size(), 0);
+  if (columns.empty()) return;
+  if (tiled_matrix_) {
+    const int B = tiled_matrix_->tile_size();
+    vector<int> order(columns.size());
+    for (int c = 0; c < (int)order.size(); c++) order[c] = c;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+      return columns[a] < columns[b];
+    });
+    for (int tile_row = 0; tile_row < tiled_matrix_->num_tiles(); tile_row++) {
+      int row_begin = tile_row * B;
+      int row_end = std::min(num_nodes_, row_begin + B);
+      for (int c = 0; c < (int)order.size(); ) {
+        int tile_column = columns[order[c]] / B;
+        const double* tile = tiled_matrix_->Tile(tile_row, tile_column);
+        int c_end = c;
+        while (c_end < (int)order.size() &&
+               columns[order[c_end]] / B == tile_column) c_end++;
+        for (int i = row_begin; i < row_end; i++) {
+          const double* tile_row_data = tile + (i - row_begin) * B;
+          for (int t = c; t < c_end; t++) {
+            sums[order[t]] += tile_row_data[columns[order[t]] % B];
+          }
+        }
+        c = c_end;
+      }
+    }
+    return;
+  }
+  if (feature_matrix_) {
+    feature_matrix_->ColumnSums(columns, sums);
+    return;
+  }
+  if (sparse_matrix_) {
+    for (int c = 0; c < (int)columns.size(); c++) {
+      sums[c] = sparse_matrix_->ColumnSum(columns[c]);
+    }
+    return;
+  }
+  if (symmetric_matrix_) {
+    for (int c = 0; c < (int)columns.size(); c++) {
+      sums[c] = symmetric_matrix_->ColumnSum(columns[c]);
+    }
+    return;
+  }
   for (int i = 0; i < num_nodes_; i++) {
-    double max_similarity = 0;
-    for (auto j : S) {
-      max_similarity = max(max_similarity, adjacency_matrix_[i][j]);
+    const vector<double>& row = adjacency_matrix_[i];
+    for (int c = 0; c < (int)columns.size(); c++) sums[c] += row[columns[c]];
+  }
+}
+
+double EvaluationOracle::CoverageSum(const vector<double>& new_row_maxima,
+                                     const vector<double>& row_maxima) const {
+  double coverage = 0;
+  if (!sample_rows_.empty() && !exact_coverage_) {
+    for (int r = 0; r < (int)sample_rows_.size(); r++) {
+      int i = sample_rows_[r];
+      coverage += sample_weights_[r] * (new_row_maxima[i] - row_maxima[i]);
     }
-    coverage += max_similarity;
+    return coverage;
   }
-  double diversity = 0;
-  for (auto i : S) {
-    for (auto j : S) {
-      diversity += adjacency_matrix_[i][j];
+  if (!BlockedCoverage()) {
+    for (int i = 0; i < num_nodes_; i++) {
+      coverage += new_row_maxima[i] - row_maxima[i];
     }
+    return coverage;
   }
+  // One pass over two rows of maxima is not worth a thread.
+  vector<double> sums(1, 0);
+  BlockedRowSums(num_nodes_, 1, sums,
+                 [&](int begin, int end, vector<double>& partial) {
+    for (int i = begin; i < end; i++) {
+      partial[0] += new_row_maxima[i] - row_maxima[i];
+    }
+  });
+  return sums[0];
+}
+
+// Image Summarization --------------------------------------------------------- 
+double EvaluationOracle::ImageSummarizationValue(const set<int>& S) const {
+  if (S.size() == 0) return 0;
+  QueryScratch& scratch = query_scratch;
+  vector<int>& members = scratch.members;
+  vector<double>& row_maxima = scratch.new_row_maxima;
+  vector<double>& zeros = scratch.row_maxima;
+  members.assign(S.begin(), S.end());
+  row_maxima.assign(num_nodes_, 0);
+  zeros.assign(num_nodes_, 0);
+  CoverRows(members, row_maxima);
+  double coverage = CoverageSum(row_maxima, zeros);
+  double diversity = SubmatrixSum(members, members);
   assert(num_nodes_ > 0);
   double value = coverage - diversity/num_nodes_;
   return value;
@@ -180,53 +1480,58 @@ double EvaluationOracle::ImageSummarizationValue(const set<int>& S) const {
 double EvaluationOracle::ImageSummarizationMarginalValue(
     int node, const set<int>& S) const {
   if (S.count(node)) return 0;
-  double coverage = 0;
-  for (int i = 0; i < num_nodes_; i++) {
-    double max_similarity = 0;
-    for (auto j : S) {
-      max_similarity = max(max_similarity, adjacency_matrix_[i][j]);
-    }
-    double new_max_similarity = max_similarity;
-    new_max_similarity = max(new_max_similarity, adjacency_matrix_[i][node]);
-    coverage += new_max_similarity - max_similarity;
-  }
-  double diversity = 0;
-  for (auto i : S) {
-    diversity += adjacency_matrix_[i][node];
-    diversity += adjacency_matrix_[node][i];
+  QueryScratch& scratch = query_scratch;
+  scratch.node.assign(1, node);
+  ImageSummarizationMarginalValues(scratch.node, S, scratch.value);
+  return scratch.value[0];
+}
+
+void EvaluationOracle::ImageSummarizationMarginalValues(
+    const vector<int>& nodes, const set<int>& S,
+    vector<double>& values) const {
+  QueryScratch& scratch = query_scratch;
+  vector<int>& members = scratch.members;
+  vector<int>& candidates = scratch.candidates;
+  vector<double>& row_maxima = scratch.row_maxima;
+  vector<double>& coverage = scratch.coverage;
+  vector<double>& diversity = scratch.diversity;
+  members.assign(S.begin(), S.end());
+  row_maxima.assign(num_nodes_, 0);
+  CoverRows(members, row_maxima);
+  candidates.clear();
+  for (auto node : nodes) {
+    assert(0 <= node && node < num_nodes_);
+    if (!S.count(node)) candidates.push_back(node);
   }
-  diversity += adjacency_matrix_[node][node];
+  CoverageGains(row_maxima, candidates, coverage);
+  PairSums(members, candidates, diversity);
   assert(num_nodes_ > 0);
-  double value = coverage - diversity/num_nodes_;
-  return value;
+  values.assign(nodes.size(), 0);
+  for (int i = 0, c = 0; i < (int)nodes.size(); i++) {
+    int node = nodes[i];
+    if (S.count(node)) continue;
+    diversity[c] += Similarity(node, node);
+    values[i] = coverage[c] - diversity[c]/num_nodes_;
+    c++;
+  }
 }
 
 double EvaluationOracle::ImageSummarizationMarginalValue(
     const set<int>& T, const set<int>& S) const {
-  double coverage = 0;
-  for (int i = 0; i < num_nodes_; i++) {
-    double max_similarity = 0;
-    for (auto j : S) {
-      max_similarity = max(max_similarity, adjacency_matrix_[i][j]);
-    }
-    double new_max_similarity = max_similarity;
-    for (auto j : T) {
-      new_max_similarity = max(new_max_similarity, adjacency_matrix_[i][j]);
-    }
-    coverage += new_max_similarity - max_similarity;
-  }
-  double diversity = 0;
-  for (auto i : S) {
-    for (auto j : T) {
-      diversity += adjacency_matrix_[i][j];
-      diversity += adjacency_matrix_[j][i];
-    }
-  }
-  for (auto i : T) {
-    for (auto j : T) {
-      diversity += adjacency_matrix_[i][j];
-    }
-  }
+  QueryScratch& scratch = query_scratch;
+  vector<int>& S_members = scratch.members;
+  vector<int>& T_members = scratch.new_members;
+  vector<double>& row_maxima = scratch.row_maxima;
+  vector<double>& new_row_maxima = scratch.new_row_maxima;
+  S_members.assign(S.begin(), S.end());
+  T_members.assign(T.begin(), T.end());
+  row_maxima.assign(num_nodes_, 0);
+  CoverRows(S_members, row_maxima);
+  new_row_maxima = row_maxima;
+  CoverRows(T_members, new_row_maxima);
+  double coverage = CoverageSum(new_row_maxima, row_maxima);
+  double diversity = CrossSum(S_members, T_members) +
+                     SubmatrixSum(T_members, T_members);
   assert(num_nodes_ > 0);
   double value = coverage - diversity/num_nodes_;
   return value;
@@ -235,18 +1540,14 @@ double EvaluationOracle::ImageSummarizationMarginalValue(
 // Movie Recommendation -------------------------------------------------------- 
 double EvaluationOracle::MovieRecommendationValue(const set<int>& S) const {
   if (S.size() == 0) return 0;
+  QueryScratch& scratch = query_scratch;
+  vector<int>& members = scratch.members;
+  vector<double>& column_sums = scratch.coverage;
+  members.assign(S.begin(), S.end());
+  ColumnSums(members, column_sums);
   double coverage = 0;
-  for (int i = 0; i < num_nodes_; i++) {
-    for (auto j : S) {
-      coverage += adjacency_matrix_[i][j];
-    }
-  }
-  double diversity = 0;
-  for (auto i : S) {
-    for (auto j : S) {
-      diversity += adjacency_matrix_[i][j];
-    }
-  }
+  for (auto x : column_sums) coverage += x;
+  double diversity = SubmatrixSum(members, members);
   const double lambda = 0.95;
   double value = coverage - lambda * diversity;
   return value;
@@ -255,42 +1556,53 @@ double EvaluationOracle::MovieRecommendationMarginalValue(int node,
                                         const set<int>& S) const {
   if (S.count(node)) return 0;
   assert(0 <= node && node < num_nodes_);
-  double coverage = 0;
-  for (int i = 0; i < num_nodes_; i++) coverage += adjacency_matrix_[i][node];
-  double diversity = 0;
-  for (auto i : S) {
-    diversity += adjacency_matrix_[i][node];
-    diversity += adjacency_matrix_[node][i];
+  QueryScratch& scratch = query_scratch;
+  scratch.node.assign(1, node);
+  MovieRecommendationMarginalValues(scratch.node, S, scratch.value);
+  return scratch.value[0];
+}
+void EvaluationOracle::MovieRecommendationMarginalValues(
+    const vector<int>& nodes, const set<int>& S,
+    vector<double>& values) const {
+  QueryScratch& scratch = query_scratch;
+  vector<int>& members = scratch.members;
+  vector<int>& candidates = scratch.candidates;
+  vector<double>& coverage = scratch.coverage;
+  vector<double>& diversity = scratch.diversity;
+  candidates.clear();
+  for (auto node : nodes) {
+    assert(0 <= node && node < num_nodes_);
+    if (!S.count(node)) candidates.push_back(node);
   }
-  diversity += adjacency_matrix_[node][node];
+  members.assign(S.begin(), S.end());
+  ColumnSums(candidates, coverage);
+  PairSums(members, candidates, diversity);
   const double lambda = 0.95;
-  double value = coverage - lambda * diversity;
-  return value;
+  values.assign(nodes.size(), 0);
+  for (int i = 0, c = 0; i < (int)nodes.size(); i++) {
+    int node = nodes[i];
+    if (S.count(node)) continue;
+    diversity[c] += Similarity(node, node);
+    values[i] = coverage[c] - lambda * diversity[c];
+    c++;
+  }
 }
 double EvaluationOracle::MovieRecommendationMarginalValue(const set<int>& T,
                                         const set<int>& S) const {
-  double coverage = 0;
-  for (int i = 0; i < num_nodes_; i++) {
-    for (auto j : T) {
-      if (S.count(j)) continue;
-      coverage += adjacency_matrix_[i][j];
-    }
-  }
-  double diversity = 0;
-  for (auto i : S) {
-    for (auto j : T) {
-      if (S.count(j)) continue;
-      diversity += adjacency_matrix_[i][j];
-      diversity += adjacency_matrix_[j][i];
-    }
-  }
-  for (auto i : T) {
-    if (S.count(i)) continue;
-    for (auto j : T) {
-      if (S.count(j)) continue;
-      diversity += adjacency_matrix_[i][j];
-    }
+  QueryScratch& scratch = query_scratch;
+  vector<int>& S_members = scratch.members;
+  vector<int>& new_members = scratch.new_members;
+  vector<double>& column_sums = scratch.coverage;
+  S_members.assign(S.begin(), S.end());
+  new_members.clear();
+  for (auto j : T) {
+    if (!S.count(j)) new_members.push_back(j);
   }
+  ColumnSums(new_members, column_sums);
+  double coverage = 0;
+  for (auto x : column_sums) coverage += x;
+  double diversity = CrossSum(S_members, new_members) +
+                     SubmatrixSum(new_members, new_members);
   const double lambda = 0.95;
   double value = coverage - lambda * diversity;
   return value;
@@ -299,8 +1611,21 @@ double EvaluationOracle::MovieRecommendationMarginalValue(const set<int>& T,
 // YouTube Revenue -------------------------------------------------------- 
 double EvaluationOracle::RevenueValue(const set<int>& S) const {
   if (S.size() == 0) return 0;  // Speedup
+  if (num_nodes_ < kMinNodesForRowBlocks) {
+    return RevenueRange(S, 0, num_nodes_);
+  }
+  vector<double> value(1, 0);
+  BlockedRowSums(num_nodes_, RowWorkers((long long)num_nodes_ + num_edges_),
+                 value, [&](int begin, int end, vector<double>& partial) {
+    partial[0] = RevenueRange(S, begin, end);
+  });
+  return value[0];
+}
+
+double EvaluationOracle::RevenueRange(const set<int>& S, int begin,
+                                      int end) const {
   double value = 0;
-  for (int i = 0; i < num_nodes_; i++) {
+  for (int i = begin; i < end; i++) {
     if (S.count(i)) continue;
     double crossing_degree = 0;
     for (const auto& kv : OutgoingEdges(i)) {
@@ -312,15 +1637,199 @@ double EvaluationOracle::RevenueValue(const set<int>& S) const {
 }
 double EvaluationOracle::RevenueMarginalValue(int node,
                                               const set<int>& S) const {
-  set<int> query_set;
-  for (auto i : S) query_set.insert(i);
+  set<int>& query_set = query_scratch.query_set;
+  query_set = S;
   query_set.insert(node);
   return RevenueValue(query_set) - RevenueValue(S);
 }
 double EvaluationOracle::RevenueMarginalValue(const set<int>& T,
                                               const set<int>& S) const {
-  set<int> query_set;
-  for (auto i : S) query_set.insert(i);
+  set<int>& query_set = query_scratch.query_set;
+  query_set = S;
   for (auto j : T) query_set.insert(j);
   return RevenueValue(query_set) - RevenueValue(S);
 }
+
+// Value Accumulator ----------------------------------------------------------
+ValueAccumulator::ValueAccumulator(const EvaluationOracle& oracle)
+    : oracle_(oracle), root_(&oracle), value_(0) {
+  while (root_->parent_ != nullptr) root_ = root_->parent_;
+  if (root_->function_name_ == "image_summarization") {
+    row_maxima_.assign(root_->num_nodes_, 0);
+  }
+}
+
+double ValueAccumulator::Gain(int node) const {
+  assert(0 <= node && node < oracle_.num_nodes_);
+  if (members_.count(node)) return 0;
+  const string& function_name = root_->function_name_;
+  if (function_name != "image_summarization" &&
+      function_name != "movie_recommendation") {
+    return oracle_.MarginalValue(node, members_);
+  }
+  PROFILE_HOT_SCOPE("ValueAccumulator::Gain");
+  for (auto oracle = &oracle_; oracle != nullptr; oracle = oracle->parent_) {
+    oracle->num_singleton_queries_++;
+  }
+  QueryTimer timer;
+  // Same sums, in the same order, as the batched marginals of the root.
+  QueryScratch& scratch = query_scratch;
+  vector<int>& candidate = scratch.candidates;
+  vector<double>& coverage = scratch.coverage;
+  vector<double>& diversity = scratch.diversity;
+  candidate.assign(1, oracle_.global_id(node));
+  if (function_name == "image_summarization") {
+    root_->CoverageGains(row_maxima_, candidate, coverage);
+  } else {
+    root_->ColumnSums(candidate, coverage);
+  }
+  root_->PairSums(root_members_, candidate, diversity);
+  diversity[0] += root_->Similarity(candidate[0], candidate[0]);
+  double gain = 0;
+  if (function_name == "image_summarization") {
+    gain = coverage[0] - diversity[0]/root_->num_nodes_;
+  } else {
+    const double lambda = 0.95;
+    gain = coverage[0] - lambda * diversity[0];
+  }
+  if (root_->query_trace_ != nullptr) {
+    set<int> root_S(root_members_.begin(), root_members_.end());
+    vector<int> nodes(1, candidate[0]);
+    root_->TraceQuery(QueryKind::kMarginal, root_S, gain, &nodes);
+  }
+  return gain;
+}
+
+double ValueAccumulator::Add(int node) {
+  if (members_.count(node)) return 0;
+  return Add(node, Gain(node));
+}
+
+double ValueAccumulator::Add(int node, double gain) {
+  if (members_.count(node)) return 0;
+  members_.insert(node);
+  int u = oracle_.global_id(node);
+  root_members_.insert(
+      std::upper_bound(root_members_.begin(), root_members_.end(), u), u);
+  if (!row_maxima_.empty()) {
+    query_scratch.candidates.assign(1, u);
+    root_->CoverRows(query_scratch.candidates, row_maxima_);
+  }
+  value_ += gain;
+  return gain;
+}
+
+// Shrinking Value ------------------------------------------------------------
+ShrinkingValue::ShrinkingValue(const EvaluationOracle& oracle,
+                               const set<int>& Y)
+    : oracle_(oracle), root_(&oracle), members_(Y) {
+  while (root_->parent_ != nullptr) root_ = root_->parent_;
+  const string& function_name = root_->function_name_;
+  incremental_ = (function_name == "image_summarization" ||
+                  function_name == "movie_recommendation") &&
+                 !root_->sampled();
+  if (!incremental_) return;
+  PROFILE_SCOPE("ShrinkingValue");
+  for (auto node : members_) {
+    assert(0 <= node && node < oracle_.num_nodes_);
+    root_members_.push_back(oracle_.global_id(node));
+  }
+  sort(root_members_.begin(), root_members_.end());
+  // Each member's pair sums with all of Y, its own entry counted twice.
+  vector<double> sums;
+  root_->PairSums(root_members_, root_members_, sums);
+  pair_sums_.assign(root_->num_nodes_, 0);
+  for (int c = 0; c < (int)root_members_.size(); c++) {
+    pair_sums_[root_members_[c]] = sums[c];
+  }
+  if (function_name == "image_summarization") {
+    int n = root_->num_nodes_;
+    best_.assign(n, 0);
+    second_.assign(n, 0);
+    best_owner_.assign(n, -1);
+    second_owner_.assign(n, -1);
+    for (int i = 0; i < n; i++) RankRow(i);
+  } else {
+    root_->ColumnSums(root_members_, sums);
+    column_sums_.assign(root_->num_nodes_, 0);
+    for (int c = 0; c < (int)root_members_.size(); c++) {
+      column_sums_[root_members_[c]] = sums[c];
+    }
+  }
+}
+
+void ShrinkingValue::RankRow(int i) {
+  double best = 0, second = 0;  // An empty set covers a row with 0.
+  int best_owner = -1, second_owner = -1;
+  for (auto j : root_members_) {
+    double similarity = root_->Similarity(i, j);
+    if (similarity > best) {
+      second = best;
+      second_owner = best_owner;
+      best = similarity;
+      best_owner = j;
+    } else if (similarity > second) {
+      second = similarity;
+      second_owner = j;
+    }
+  }
+  best_[i] = best;
+  second_[i] = second;
+  best_owner_[i] = best_owner;
+  second_owner_[i] = second_owner;
+}
+
+double ShrinkingValue::Loss(int node) const {
+  assert(0 <= node && node < oracle_.num_nodes_);
+  if (!members_.count(node)) return 0;
+  if (!incremental_) {
+    members_.erase(node);
+    double loss = oracle_.MarginalValue(node, members_);
+    members_.insert(node);
+    return loss;
+  }
+  PROFILE_HOT_SCOPE("ShrinkingValue::Loss");
+  for (auto oracle = &oracle_; oracle != nullptr; oracle = oracle->parent_) {
+    oracle->num_singleton_queries_++;
+  }
+  QueryTimer timer;
+  int u = oracle_.global_id(node);
+  // The pairs of u with Y - u, and its diagonal entry.
+  double diversity = pair_sums_[u] - root_->Similarity(u, u);
+  double loss = 0;
+  if (!best_.empty()) {
+    // Only the rows u covers best lose anything, down to their second best.
+    double coverage = 0;
+    for (int i = 0; i < root_->num_nodes_; i++) {
+      if (best_owner_[i] == u) coverage += best_[i] - second_[i];
+    }
+    loss = coverage - diversity/root_->num_nodes_;
+  } else {
+    const double lambda = 0.95;
+    loss = column_sums_[u] - lambda * diversity;
+  }
+  if (root_->query_trace_ != nullptr) {
+    set<int> root_S(root_members_.begin(), root_members_.end());
+    root_S.erase(u);
+    vector<int> nodes(1, u);
+    root_->TraceQuery(QueryKind::kMarginal, root_S, loss, &nodes);
+  }
+  return loss;
+}
+
+void ShrinkingValue::Remove(int node) {
+  if (!members_.count(node)) return;
+  members_.erase(node);
+  if (!incremental_) return;
+  int u = oracle_.global_id(node);
+  root_members_.erase(
+      std::lower_bound(root_members_.begin(), root_members_.end(), u));
+  vector<double> sums;
+  root_->PairSums(vector<int>(1, u), root_members_, sums);
+  for (int c = 0; c < (int)root_members_.size(); c++) {
+    pair_sums_[root_members_[c]] -= sums[c];
+  }
+  for (int i = 0; i < (int)best_.size(); i++) {
+    if (best_owner_[i] == u || second_owner_[i] == u) RankRow(i);
+  }
+}
@@ -2,21 +2,119 @@
 #define EVALUATION_ORACLE_H_
 
 #include <map>
+#include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
+#include "feature_matrix.h"
+#include "query_trace.h"
+#include "sparse_matrix.h"
+#include "symmetric_matrix.h"
+#include "tiled_matrix.h"
+
 class EvaluationOracle {
  public:
-  EvaluationOracle() : num_nodes_(0), num_edges_(0) {}
-  EvaluationOracle(std::string filename, std::string function_name);
+  EvaluationOracle()
+      : num_nodes_(0), num_edges_(0), parent_(nullptr),
+        coverage_error_bound_(0), exact_near_threshold_(false),
+        exact_coverage_(false), query_trace_(nullptr), num_value_queries_(0),
+        num_singleton_queries_(0), num_set_queries_(0),
+        num_exact_reevaluations_(0), generation_(0),
+        singleton_generation_(0) {}
+  // filename is an edge list, as text or, if it ends in .edges, in the
+  // binary format of edge_list.h. Similarity objectives also accept a matrix
+  // converted with TiledMatrix::Convert (a filename ending in .tiles), which
+  // is read from disk through a cache of at most tile_cache_size tiles
+  // instead of being loaded into memory, or a FeatureMatrix file (ending in
+  // .features), from which similarities are computed on demand. A
+  // similarity matrix read from an edge list that turns out to be symmetric
+  // is stored as its packed upper triangle.
+  EvaluationOracle(std::string filename, std::string function_name,
+                   int tile_cache_size=TiledMatrix::kDefaultCacheTiles);
+  // View of parent restricted to the elements in ground_set: node i of the
+  // view is node ground_set[i] of parent. The objective is unchanged and
+  // queries are forwarded to parent, which must outlive the view.
+  EvaluationOracle(const EvaluationOracle& parent,
+                   const std::vector<int>& ground_set);
+  // Id of node in the original (non-restricted) oracle.
+  int global_id(int node) const;
+  // Replaces the similarity matrix of image summarization or movie
+  // recommendation by a sparse one that keeps, in each row, the entries
+  // above threshold and at most the neighbors largest of them (all of them
+  // if neighbors <= 0). Queries then only touch the stored entries, at the
+  // price of approximating f.
+  void Sparsify(int neighbors, double threshold=0);
+  // Estimates the coverage term of image summarization from sample_size
+  // rows drawn with probability proportional to their largest similarity,
+  // so coverage loops take sample_size instead of n steps. By Hoeffding's
+  // inequality each estimated value or marginal is within
+  // coverage_error_bound() of the exact one with probability at least
+  // 1 - failure_probability. If exact_near_threshold, MarginalAtLeast
+  // recomputes exactly the values that fall within the bound of its
+  // threshold. A sample_size <= 0 restores exact coverage.
+  void SampleCoverageRows(int sample_size, double failure_probability=0.05,
+                          bool exact_near_threshold=true, unsigned seed=1);
+  bool sampled() const;
+  double coverage_error_bound() const;
+  long long num_exact_reevaluations() const;
+  // Records every query made on this oracle or its views into trace, which
+  // must outlive the recording, until set to nullptr. Only an oracle that is
+  // not a view records, in its own ids. Queries must then come from one
+  // thread at a time.
+  void set_query_trace(QueryTraceWriter* trace);
   int num_nodes() const { return num_nodes_; }
   int num_edges() const { return num_edges_; }
   std::string function_name() const { return function_name_; }
+  // Number of Value and MarginalValue calls made on this oracle, by type.
+  long long num_queries() const {
+    return num_value_queries_ + num_singleton_queries_ + num_set_queries_;
+  }
+  long long num_value_queries() const { return num_value_queries_; }
+  long long num_singleton_queries() const { return num_singleton_queries_; }
+  long long num_set_queries() const { return num_set_queries_; }
+  // Wall time spent in Value and MarginalValue across all oracles. Timing
+  // costs two clock reads per query and can be switched off for benchmarks.
+  static double total_query_seconds();
+  static void set_query_timing(bool enabled);
+  // Bytes of similarity tiles read from disk across all oracles.
+  static long long total_io_bytes();
+  // Full Value(S) evaluations across all oracles, each counted once even
+  // when made through a view.
+  static long long total_value_queries();
+  // Threads used for parallel oracle work, by default one per hardware
+  // thread. Batches of queries are spread across them; on oracles with many
+  // nodes, so are the rows of a single query.
+  static int num_threads();
+  static void set_num_threads(int num_threads);
   const std::vector<std::pair<int, double>>& OutgoingEdges(int node) const;
   const std::vector<std::pair<int, double>>& IncomingEdges(int node) const;
   double Value(const std::set<int>& S) const;
   double MarginalValue(int node, const std::set<int>& S) const;
   double MarginalValue(const std::set<int>& T, const std::set<int>& S) const;
+  // values[i] = MarginalValue(nodes[i], S), sharing the work that depends
+  // only on S across the batch. Counts as nodes.size() singleton queries.
+  void MarginalValues(const std::vector<int>& nodes, const std::set<int>& S,
+                      std::vector<double>& values) const;
+  // values[t] = MarginalValue(sets[t], S). The state of S (the row maxima
+  // of image summarization, f(S) of revenue) is computed once for the whole
+  // batch, and the sets are evaluated in parallel (see BatchWorkers). Counts
+  // as sets.size() set queries.
+  void MarginalValues(const std::vector<std::set<int>>& sets,
+                      const std::set<int>& S,
+                      std::vector<double>& values) const;
+  // f({u}) for every node u, computed once in parallel and then cached. The
+  // first call counts as num_nodes() singleton queries.
+  const std::vector<double>& SingletonValues() const;
+  // Whether value, a MarginalValue(node, S) of this oracle, is at least
+  // threshold. See SampleCoverageRows.
+  bool MarginalAtLeast(double value, double threshold, int node,
+                       const std::set<int>& S) const;
+  // above[i] = MarginalAtLeast(values[i], threshold, nodes[i], S), with the
+  // exact recomputations done as one batch.
+  void MarginalsAtLeast(const std::vector<int>& nodes, const std::set<int>& S,
+                        const std::vector<double>& values, double threshold,
+                        std::vector<char>& above) const;
   double GraphCutValue(const std::set<int>& S) const;
   double GraphCutMarginalValue(int node, const std::set<int>& S) const;
   double GraphCutMarginalValue(
@@ -26,22 +124,186 @@ class EvaluationOracle {
       int node, const std::set<int>& S) const;
   double ImageSummarizationMarginalValue(
       const std::set<int>& T, const std::set<int>& S) const;
+  void ImageSummarizationMarginalValues(const std::vector<int>& nodes,
+      const std::set<int>& S, std::vector<double>& values) const;
   double MovieRecommendationValue(const std::set<int>& S) const;
   double MovieRecommendationMarginalValue(
       int node, const std::set<int>& S) const;
   double MovieRecommendationMarginalValue(
       const std::set<int>& T, const std::set<int>& S) const;
+  void MovieRecommendationMarginalValues(const std::vector<int>& nodes,
+      const std::set<int>& S, std::vector<double>& values) const;
   double RevenueValue(const std::set<int>& S) const;
   double RevenueMarginalValue(int node, const std::set<int>& S) const;
   double RevenueMarginalValue(
       const std::set<int>& T, const std::set<int>& S) const;
  private:
+  friend class ShrinkingValue;
+  friend class ValueAccumulator;
+  std::set<int> ToParent(const std::set<int>& S) const;
+  // Adds a query to query_trace_, with the operands of its kind.
+  void TraceQuery(QueryKind kind, const std::set<int>& S, double result,
+                  const std::vector<int>* nodes=nullptr,
+                  const std::vector<std::set<int>>* sets=nullptr) const;
+  double SingletonMarginalValue(int node, const std::set<int>& S) const;
+  // Threads for a batch of batch_size queries, at least min_per_thread per
+  // thread. A large oracle evaluates a batch that cannot occupy every thread
+  // one query at a time, each split over RowWorkers threads instead.
+  int BatchWorkers(int batch_size, int min_per_thread) const;
+  // Threads over the rows of a single query that reads entries matrix
+  // entries (or edges); 1 on small or tiled oracles and within a batch
+  // spread by BatchWorkers.
+  int RowWorkers(long long entries) const;
+  // Whether coverage sums over all rows are taken over fixed blocks of rows,
+  // so that they do not depend on RowWorkers. Sparse and tiled matrices keep
+  // their sequential kernels.
+  bool BlockedCoverage() const;
+  // Similarity kernels, dispatching on how the matrix is stored.
+  double Similarity(int i, int j) const;
+  // Raises row_maxima[i] to the largest similarity(i, j) over j in columns.
+  void CoverRows(const std::vector<int>& columns,
+                 std::vector<double>& row_maxima) const;
+  // CoverRows over rows [begin, end) of a dense, symmetric or feature matrix.
+  void CoverRowRange(const std::vector<int>& columns,
+                     std::vector<double>& row_maxima, int begin,
+                     int end) const;
+  // gains[c] = sum over rows i of
+  //   max(row_maxima[i], similarity(i, candidates[c])) - row_maxima[i].
+  // A tiled matrix streams each tile it needs once for the whole batch.
+  void CoverageGains(const std::vector<double>& row_maxima,
+                     const std::vector<int>& candidates,
+                     std::vector<double>& gains) const;
+  // Adds the terms of rows [begin, end) of CoverageGains to gains, for a
+  // dense, symmetric or feature matrix.
+  void CoverageGainRange(const std::vector<double>& row_maxima,
+                         const std::vector<int>& candidates, int begin,
+                         int end, std::vector<double>& gains) const;
+  // gains[t] = sum over rows i of
+  //   max(row_maxima[i], max over j in sets[t] of similarity(i, j))
+  //     - row_maxima[i],
+  // summed over the rows in increasing order (block by block if
+  // BlockedCoverage). A dense or symmetric matrix is read one row at a time
+  // for all the sets.
+  void SetCoverageGains(const std::vector<double>& row_maxima,
+                        const std::vector<std::vector<int>>& sets,
+                        std::vector<double>& gains) const;
+  // Adds the terms of rows [begin, end) of SetCoverageGains to gains, for a
+  // dense or symmetric matrix.
+  void SetCoverageGainRange(const std::vector<double>& row_maxima,
+                            const std::vector<std::vector<int>>& sets,
+                            int begin, int end,
+                            std::vector<double>& gains) const;
+  // sums[c] = sum over j in members, in order, of similarity(j, c) plus
+  // similarity(c, j), where c = candidates[c].
+  void PairSums(const std::vector<int>& members,
+                const std::vector<int>& candidates,
+                std::vector<double>& sums) const;
+  // Sum of similarity(i, j) over i in rows and j in columns.
+  double SubmatrixSum(const std::vector<int>& rows,
+                      const std::vector<int>& columns) const;
+  // SubmatrixSum(rows, columns) + SubmatrixSum(columns, rows).
+  double CrossSum(const std::vector<int>& rows,
+                  const std::vector<int>& columns) const;
+  // Sum over all rows i of new_row_maxima[i] - row_maxima[i], or its
+  // importance-weighted estimate from the sampled rows. Sums over all rows
+  // are taken in the order of CoverageGains and SetCoverageGains.
+  double CoverageSum(const std::vector<double>& new_row_maxima,
+                     const std::vector<double>& row_maxima) const;
+  // Row i of the similarity matrix, densely.
+  void SimilarityRow(int i, std::vector<double>& row) const;
+  // sums[c] = sum over all rows i of similarity(i, columns[c]).
+  void ColumnSums(const std::vector<int>& columns,
+                  std::vector<double>& sums) const;
+  // Revenue of the nodes in [begin, end) outside S.
+  double RevenueRange(const std::set<int>& S, int begin, int end) const;
+
   int num_nodes_;
   int num_edges_;
   std::vector<std::vector<std::pair<int, double>>> adjacency_list_;
   std::vector<std::vector<std::pair<int, double>>> reverse_adjacency_list_;
   std::vector<std::vector<double>> adjacency_matrix_;
+  // At most one of these replaces adjacency_matrix_.
+  std::shared_ptr<TiledMatrix> tiled_matrix_;
+  std::shared_ptr<FeatureMatrix> feature_matrix_;
+  std::shared_ptr<SparseMatrix> sparse_matrix_;
+  std::shared_ptr<SymmetricMatrix> symmetric_matrix_;
   std::string function_name_;
+  const EvaluationOracle* parent_;
+  std::vector<int> ground_set_;  // Ids in parent_ of the nodes of a view
+  // Sampled coverage rows (sorted) and their importance weights.
+  std::vector<int> sample_rows_;
+  std::vector<double> sample_weights_;
+  double coverage_error_bound_;
+  bool exact_near_threshold_;
+  mutable bool exact_coverage_;  // Ignore the sample while re-evaluating
+  QueryTraceWriter* query_trace_;  // Null unless recording
+  mutable long long num_value_queries_;
+  mutable long long num_singleton_queries_;
+  mutable long long num_set_queries_;
+  mutable long long num_exact_reevaluations_;
+  mutable std::vector<double> singleton_values_;  // Empty until computed
+  // Bumped when Sparsify or SampleCoverageRows change the objective, so
+  // that views know to recopy their singleton values.
+  long long generation_;
+  // generation_ of the root when a view last copied singleton_values_.
+  mutable long long singleton_generation_;
+};
+
+// Running value of a set S that only grows, for algorithms that would
+// otherwise call Value(S) on every prefix. Image summarization keeps the
+// row maxima of S, so a Gain or Add takes one pass over the rows instead
+// of rebuilding them from S; movie recommendation only needs the members,
+// and the other objectives fall back to MarginalValue. Gain and Add count
+// as singleton queries of oracle, which must outlive the accumulator.
+class ValueAccumulator {
+ public:
+  explicit ValueAccumulator(const EvaluationOracle& oracle);
+  const std::set<int>& members() const { return members_; }
+  double value() const { return value_; }
+  // f(S + node) - f(S).
+  double Gain(int node) const;
+  // Adds node to S and returns its gain.
+  double Add(int node);
+  // Adds node to S with gain, the value of Gain(node) for the current S, so
+  // that it is not computed again.
+  double Add(int node, double gain);
+ private:
+  const EvaluationOracle& oracle_;
+  const EvaluationOracle* root_;  // Non-view oracle that owns the matrix
+  std::set<int> members_;
+  std::vector<int> root_members_;  // Ids of members_ in root_, sorted
+  std::vector<double> row_maxima_;
+  double value_;
+};
+
+// The counterpart of ValueAccumulator for a set Y that only shrinks, such
+// as the back set of double greedy. Image summarization keeps the best and
+// second best similarity of each row over Y, so a Loss reads one entry per
+// row and a Remove rescans only the rows whose best two it held; both
+// objectives with a similarity matrix keep each member's pair sums with Y.
+// Other objectives, and sampled coverage, fall back to MarginalValue. Loss
+// counts as a singleton query of oracle, which must outlive this.
+class ShrinkingValue {
+ public:
+  ShrinkingValue(const EvaluationOracle& oracle, const std::set<int>& Y);
+  const std::set<int>& members() const { return members_; }
+  // f(Y) - f(Y - node) for node in Y, and 0 otherwise.
+  double Loss(int node) const;
+  void Remove(int node);
+ private:
+  // Finds the best two entries of row i over Y.
+  void RankRow(int i);
+
+  const EvaluationOracle& oracle_;
+  const EvaluationOracle* root_;  // Non-view oracle that owns the matrix
+  bool incremental_;
+  mutable std::set<int> members_;  // Loss briefly removes node to fall back
+  std::vector<int> root_members_;  // Ids of members_ in root_, sorted
+  std::vector<double> pair_sums_;  // Indexed by root id
+  std::vector<double> column_sums_;  // Movie recommendation
+  // Image summarization, by row of root_.
+  std::vector<double> best_, second_;
+  std::vector<int> best_owner_, second_owner_;  // -1 if none
 };
 
 #endif  // EVALUATION_ORACLE_H_
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <map>
 
 #include "adaptive_maximization.h"
 #include "fantom.h"
+#include "profiler.h"
 #include "utilities.h"
 
 using std::cout;
@@ -12,82 +15,185 @@ using std::set;
 using std::string;
 using std::vector;
 
-set<int> GDT(const EvaluationOracle&  oracle, const set<int>& omega, double rho,
-    int size_constraint, MaximizationResult& result, bool debug) {
-  int num_queries = result.num_queries.back();
+// Greedy order chosen by GDT over omega. Only where it stops depends on rho
+// (at the first gain below rho) and on the size constraint, so the pass is
+// extended lazily and replayed for every rho guess and constraint.
+struct GreedyPass {
+  int best_element = -1;
+  double maximum_marginal = -1;
+  int singleton_queries = 0;
+  vector<int> omega;  // Ground set of the pass, in increasing order
+  set<int> S;  // elements, for the marginals of the next step
+  vector<int> elements;
+  vector<double> gains;
+  vector<int> num_queries;  // Queries spent choosing each element
+  bool complete = false;  // No element of omega is left to choose
+  bool truncated = false;  // Stopped early because the budget ran out
+};
+
+// Greedy passes shared by all rho guesses: the first over the whole ground
+// set, and a second for each set that the first GDT of IGDT can return,
+// over the ground set minus that set.
+struct SharedPasses {
+  GreedyPass first;
+  std::map<set<int>, GreedyPass> second;
+};
+
+GreedyPass StartGreedyPass(const EvaluationOracle& oracle,
+                           const set<int>& omega) {
+  PROFILE_SCOPE("GDT/maximum_marginal");
+  GreedyPass pass;
   // Maximum marginal
   set<int> empty_set;
-  double maximum_marginal = -1;
-  int best_element = -1;
-  for (auto x : omega) {
-    double gain = oracle.MarginalValue(x, empty_set);
-    if (gain > maximum_marginal) {
-      maximum_marginal = gain;
-      best_element = x;
+  pass.omega.assign(omega.begin(), omega.end());
+  vector<double> singletons;
+  oracle.MarginalValues(pass.omega, empty_set, singletons);
+  for (int i = 0; i < (int)pass.omega.size(); i++) {
+    if (singletons[i] > pass.maximum_marginal) {
+      pass.maximum_marginal = singletons[i];
+      pass.best_element = pass.omega[i];
     }
   }
-  num_queries += omega.size();
-  assert(best_element != -1);
-  set<int> best_element_set; best_element_set.insert(best_element);
+  pass.singleton_queries = omega.size();
+  assert(pass.best_element != -1);
+  return pass;
+}
 
+// Extends pass until GDT with rho and size_constraint would stop on it.
+void ExtendGreedyPass(const EvaluationOracle& oracle, double rho,
+    int size_constraint, const Budget& budget, GreedyPass& pass) {
+  PROFILE_SCOPE("GDT/greedy_pass");
   // Density greedy step
-  set<int> S;
-  double function_value = 0;
-  for (int i = 0; i < size_constraint; i++) {
+  vector<int> remaining;
+  vector<double> gains;
+  while ((int)pass.elements.size() < size_constraint && !pass.complete &&
+         (pass.gains.empty() || pass.gains.back() >= rho)) {
+    if (pass.truncated || budget.Exhausted()) {
+      pass.truncated = true;
+      break;
+    }
     double best_marginal = -1;
     int best_element = -1;
-    for (auto x : omega) {
-      if (S.count(x)) continue;
-      double gain = oracle.MarginalValue(x, S);
-      num_queries++;
-      if (gain > best_marginal) {
-        best_marginal = gain;
-        best_element = x;
+    remaining.clear();
+    for (auto x : pass.omega) {
+      if (!pass.S.count(x)) remaining.push_back(x);
+    }
+    oracle.MarginalValues(remaining, pass.S, gains);
+    int num_queries = remaining.size();
+    for (int j = 0; j < (int)remaining.size(); j++) {
+      if (gains[j] > best_marginal) {
+        best_marginal = gains[j];
+        best_element = remaining[j];
       }
     }
-    if (best_marginal < rho) break;  
+    if (best_element == -1) {
+      pass.complete = true;
+      break;
+    }
+    // Kept even if below rho, for the smaller guesses.
+    pass.S.insert(best_element);
+    pass.elements.push_back(best_element);
+    pass.gains.push_back(best_marginal);
+    pass.num_queries.push_back(num_queries);
+  }
+}
+
+// Replays GDT with rho on pass, reporting the queries it would have made on
+// its own. Also stores the value of the returned set in *value, which the
+// replayed gains already give.
+set<int> ReplayGreedyPass(const GreedyPass& pass, double rho,
+    int size_constraint, MaximizationResult& result, double* value) {
+  int num_queries = result.num_queries.back() + pass.singleton_queries;
+  set<int> best_element_set; best_element_set.insert(pass.best_element);
+  set<int> S;
+  double function_value = 0;
+  int length = 0;
+  while (length < std::min(size_constraint, (int)pass.elements.size()) &&
+         pass.gains[length] >= rho) {
+    length++;
+  }
+  if (pass.truncated && length == (int)pass.elements.size() &&
+      length < size_constraint) {
+    result.truncated = true;
+  }
+  for (int i = 0; i < length; i++) {
+    int best_element = pass.elements[i];
+    double best_marginal = pass.gains[i];
+    num_queries += pass.num_queries[i];
     S.insert(best_element);
     function_value += best_marginal;
 
     // Update maximization results.
-    result.num_rounds++;
-    set<int> T; T.insert(best_element);
-    result.elements_added.push_back(T);
-    result.marginal_gains.push_back(best_marginal);
+    result.AddRound();
+    result.AddElement(best_element);
+    result.marginal_gains[result.num_rounds] = best_marginal;
     // For FANTOM only track improvements
-    result.function_values.push_back(result.function_values.back()); 
     if (function_value > result.function_values.back()) {
       result.function_values[result.num_rounds] = function_value;
     }
-    result.num_queries.push_back(num_queries);
+    result.num_queries[result.num_rounds] = num_queries;
   }
 
   set<int> ans = best_element_set;
-  if (maximum_marginal < function_value) {
+  *value = pass.maximum_marginal;
+  if (pass.maximum_marginal < function_value) {
     ans = S;
+    *value = function_value;
     if (function_value > result.function_values[result.num_rounds]) {
       result.function_values[result.num_rounds] = function_value;
     }
   } else {
-    result.function_values[result.num_rounds] = maximum_marginal;
-    if (maximum_marginal > result.function_values[result.num_rounds]) {
-      result.function_values[result.num_rounds] = maximum_marginal;
-    }
+    result.function_values[result.num_rounds] = pass.maximum_marginal;
   }
   return ans;
 }
 
-set<int> IGDT(const EvaluationOracle&  oracle, double rho, int size_constraint,
-    MaximizationResult& result, bool debug) {
-  int n = oracle.num_nodes();
-  set<int> omega;
-  for (int i = 0; i < n; i++) omega.insert(i);
+set<int> GDT(const EvaluationOracle& oracle, GreedyPass& pass, double rho,
+    int size_constraint, MaximizationResult& result, const Budget& budget,
+    double* value) {
+  ExtendGreedyPass(oracle, rho, size_constraint, budget, pass);
+  return ReplayGreedyPass(pass, rho, size_constraint, result, value);
+}
+
+// The pass of the first GDT of IGDT, started on first use.
+GreedyPass& FirstPass(const EvaluationOracle& oracle, SharedPasses& passes) {
+  if (passes.first.best_element == -1) {
+    set<int> omega;
+    for (int i = 0; i < oracle.num_nodes(); i++) omega.insert(i);
+    passes.first = StartGreedyPass(oracle, omega);
+  }
+  return passes.first;
+}
+
+// The pass of the second GDT of IGDT, after the first returned S.
+GreedyPass& SecondPass(const EvaluationOracle& oracle, SharedPasses& passes,
+                       const set<int>& S) {
+  auto it = passes.second.find(S);
+  if (it == passes.second.end()) {
+    set<int> omega;
+    for (auto x : passes.first.omega) {
+      if (!S.count(x)) omega.insert(x);
+    }
+    it = passes.second.emplace(S, StartGreedyPass(oracle, omega)).first;
+  }
+  return it->second;
+}
 
-  set<int> ans;
+set<int> IGDT(const EvaluationOracle&  oracle, double rho, int size_constraint,
+    MaximizationResult& result, bool debug, const Budget& budget,
+    SharedPasses& passes, UnconstrainedMethod method) {
+  set<int> ans, first_S;
   double max_function_value = -1;
   for (int i = 1; i <= 2; i++) {  // p = 1
-    set<int> S = GDT(oracle, omega, rho, size_constraint, result, debug);
-    double S_value = oracle.Value(S);
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
+    GreedyPass& pass = i == 1 ? FirstPass(oracle, passes)
+                              : SecondPass(oracle, passes, first_S);
+    double S_value;
+    set<int> S = GDT(oracle, pass, rho, size_constraint, result, budget,
+                     &S_value);
     if (S_value > max_function_value) {
       ans = S;
       max_function_value = S_value;
@@ -99,64 +205,146 @@ set<int> IGDT(const EvaluationOracle&  oracle, double rho, int size_constraint,
     const double delta = 0.01;
 
     // Update maximization results.
-    result.num_rounds++;
-    set<int> T;
-    result.elements_added.push_back(T);
-    result.marginal_gains.push_back(0);
-    result.function_values.push_back(result.function_values.back());
-    result.num_queries.push_back(result.num_queries.back());
+    result.AddRound();
+    double unconstrained_value;
     set<int> S_prime = UnconstrainedMaximization(oracle, empty_set, S_vector,
-        epsilon, delta, result);
-    double unconstrained_value = oracle.Value(S_prime);
+        epsilon, delta, result, budget, &unconstrained_value, method);
     if (unconstrained_value > max_function_value) {
       ans = S_prime;
       max_function_value = unconstrained_value;
       result.function_values[result.num_rounds] = unconstrained_value;
     }
-    for (auto x : S) {
-      omega.erase(x);
-    }
+    result.UpdateRoundStats();
+    first_S.swap(S);
   }
-  assert(max_function_value != -1);
+  assert(max_function_value != -1 || result.truncated);
   return ans;
 }
 
-MaximizationResult Fantom(const EvaluationOracle& oracle,
-                          int size_constraint, double epsilon, bool debug) {
-  // Compute maximum marginal
-  int n = oracle.num_nodes();
+double MaximumMarginal(const EvaluationOracle& oracle) {
+  PROFILE_SCOPE("MaximumMarginal");
   double max_marginal = -1;
-  set<int> empty_set;
-  for (int i = 0; i < n; i++) {
-    double gain = oracle.MarginalValue(i, empty_set);
+  for (auto gain : oracle.SingletonValues()) {
     if (gain > max_marginal) {
       max_marginal = gain;
     }
   }
+  return max_marginal;
+}
+
+MaximizationResult Fantom(const EvaluationOracle& oracle,
+                          int size_constraint, double epsilon, bool debug,
+                          const Budget& budget, UnconstrainedMethod method) {
+  // Compute maximum marginal
+  int n = oracle.num_nodes();
+  double max_marginal = MaximumMarginal(oracle);
 
   double gamma = 2.0 * max_marginal / (2.0 * 5.0);  // p = 1 for cardinality
 
   double max_function_value = -1;
   MaximizationResult ans;
 
+  // Each guess reports the queries it would make on its own, while the
+  // greedy passes are only run once for all of them.
+  SharedPasses passes;
+  long long start_queries = oracle.num_queries();
+  long long per_guess_queries = 0;
   int rounds = ceil(log(n) / log(1 + epsilon));
   cout << "rounds: " << rounds << endl;
-  for (int i = 0; i <= rounds; i++) {
+  for (int i : budget.GuessOrder(rounds + 1)) {
+    if (budget.Exhausted()) {
+      ans.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("Fantom/guess");
     double rho = gamma * pow(1.0 + epsilon, i);
     cout << "round: " << i << "/" << rounds << "\trho: " << rho << endl;
     MaximizationResult result;
-    set<int> S = IGDT(oracle, rho, size_constraint, result, debug);
+    set<int> S = IGDT(oracle, rho, size_constraint, result, debug, budget,
+                      passes, method);
     cout << "f(S): " << result.function_values.back() << "\t";
     cout << "|S|: " << S.size() << endl << endl;
+    per_guess_queries += result.num_queries.back();
+    bool truncated = result.truncated;
+    result.solution.assign(S.begin(), S.end());
     if (result.function_values.back() > max_function_value) {
       max_function_value = result.function_values.back();
-      ans = result;
+      ans = std::move(result);
+    }
+    if (truncated) {
+      ans.truncated = true;
+      break;
+    }
+  }
+  cout << "queries: " << per_guess_queries << " by the guesses, ";
+  cout << oracle.num_queries() - start_queries << " made" << endl;
+  assert(max_function_value != -1 || ans.truncated);
+  return ans;
+}
+
+vector<MaximizationResult> FantomSweep(const EvaluationOracle& oracle,
+    const vector<int>& size_constraints, double epsilon, bool debug,
+    const Budget& budget, UnconstrainedMethod method) {
+  assert(size_constraints.size() > 0);
+  int n = oracle.num_nodes();
+  double max_marginal = MaximumMarginal(oracle);
+  double gamma = 2.0 * max_marginal / (2.0 * 5.0);  // p = 1 for cardinality
+
+  int num_constraints = size_constraints.size();
+  vector<double> max_function_values(num_constraints, -1);
+  vector<MaximizationResult> ans(num_constraints);
+
+  // The greedy passes of every guess are prefixes of the shared ones for the
+  // largest constraint.
+  SharedPasses passes;
+  int rounds = ceil(log(n) / log(1 + epsilon));
+  cout << "rounds: " << rounds << endl;
+  bool truncated = false;
+  for (int i : budget.GuessOrder(rounds + 1)) {
+    if (truncated || budget.Exhausted()) {
+      truncated = true;
+      break;
+    }
+    double rho = gamma * pow(1.0 + epsilon, i);
+    cout << "round: " << i << "/" << rounds << "\trho: " << rho << endl;
+    for (int j = 0; j < num_constraints; j++) {
+      MaximizationResult result;
+      set<int> S = IGDT(oracle, rho, size_constraints[j], result, debug,
+                        budget, passes, method);
+      cout << " - k: " << size_constraints[j] << "\t";
+      cout << "f(S): " << result.function_values.back() << "\t";
+      cout << "|S|: " << S.size() << endl;
+      if (result.truncated) truncated = true;
+      result.solution.assign(S.begin(), S.end());
+      if (result.function_values.back() > max_function_values[j]) {
+        max_function_values[j] = result.function_values.back();
+        ans[j] = std::move(result);
+      }
     }
+    cout << endl;
+  }
+  for (int j = 0; j < num_constraints; j++) {
+    if (truncated) ans[j].truncated = true;
+    assert(max_function_values[j] != -1 || truncated);
   }
-  assert(max_function_value != -1);
   return ans;
 }
 
+void TestFantomSweep(const EvaluationOracle& oracle,
+                     const vector<int>& size_constraints, double epsilon,
+                     string output_path) {
+  cout << "Running fantom_sweep...\n";
+  const bool debug = true;
+  auto results = FantomSweep(oracle, size_constraints, epsilon, debug);
+  for (int i = 0; i < (int)size_constraints.size(); i++) {
+    string output_filename = output_path;
+    output_filename += "constraint_" + int_to_str(size_constraints[i]) + "-";
+    output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
+    output_filename += "fantom" RESULT_EXTENSION;
+    results[i].Write(output_filename);
+  }
+}
+
 void TestFantom(const EvaluationOracle& oracle,
                 int size_constraint, double epsilon, string output_path) {
   cout << "Running fantom...\n";
@@ -165,6 +353,6 @@ void TestFantom(const EvaluationOracle& oracle,
   string output_filename = output_path;
   output_filename += "constraint_" + int_to_str(size_constraint) + "-";
   output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
-  output_filename += "fantom.txt";
+  output_filename += "fantom" RESULT_EXTENSION;
   result.Write(output_filename);
 }
@@ -1,8 +1,27 @@
+#include "adaptive_maximization.h"
+#include "budget.h"
 #include "evaluation_oracle.h"
 #include "maximization_result.h"
 
+// FANTOM runs two greedy passes for each rho guess. Their greedy order does
+// not depend on rho, which only decides where they stop, so each distinct
+// pass is computed once, as far as some guess needs it, and cut for the
+// others. The results still report the queries of a separate run per guess.
 MaximizationResult Fantom(const EvaluationOracle& oracle,
-    int size_constraint, double epsilon, bool debug=false);
+    int size_constraint, double epsilon, bool debug=false,
+    const Budget& budget=Budget(),
+    UnconstrainedMethod method=UnconstrainedMethod::kRandomSubsets);
+
+// Runs FANTOM for each size constraint, sharing the maximum marginal and the
+// greedy passes across all of them.
+std::vector<MaximizationResult> FantomSweep(const EvaluationOracle& oracle,
+    const std::vector<int>& size_constraints, double epsilon,
+    bool debug=false, const Budget& budget=Budget(),
+    UnconstrainedMethod method=UnconstrainedMethod::kRandomSubsets);
 
 void TestFantom(const EvaluationOracle& oracle,
     int size_constraint, double epsilon, std::string output_path);
+
+void TestFantomSweep(const EvaluationOracle& oracle,
+    const std::vector<int>& size_constraints, double epsilon,
+    std::string output_path);
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "feature_matrix.h"
+
+using std::cerr;
+using std::endl;
+using std::exp;
+using std::ifstream;
+using std::sqrt;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Columns per packed panel. A compile-time width lets the accumulation
+// loops below be unrolled and vectorized without reassociating any sum.
+const int kPanelWidth = 8;
+
+}  // namespace
+
+FeatureMatrix::FeatureMatrix(string filename)
+    : num_nodes_(0), dimension_(0), cosine_(true), gamma_(0) {
+  ifstream file(filename);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return;
+  }
+  int n, d;
+  file >> n >> d >> kernel_;
+  assert(kernel_ == "cosine" || kernel_ == "rbf");
+  cosine_ = kernel_ == "cosine";
+  if (!cosine_) file >> gamma_;
+  features_.resize((size_t)n * d);
+  for (auto& x : features_) file >> x;
+  if (!file) {
+    cerr << "truncated feature file: " << filename << endl;
+    features_.clear();
+    return;
+  }
+  num_nodes_ = n;
+  dimension_ = d;
+  feature_sum_.assign(d, 0);
+  for (int i = 0; i < n; i++) {
+    double* x = &features_[(size_t)i * d];
+    if (cosine_) {
+      double norm = 0;
+      for (int k = 0; k < d; k++) norm += x[k] * x[k];
+      norm = sqrt(norm);
+      if (norm > 0) {
+        for (int k = 0; k < d; k++) x[k] /= norm;
+      }
+    }
+    for (int k = 0; k < d; k++) feature_sum_[k] += x[k];
+  }
+}
+
+double FeatureMatrix::Similarity(int i, int j) const {
+  assert(0 <= i && i < num_nodes_ && 0 <= j && j < num_nodes_);
+  const double* x = &features_[(size_t)i * dimension_];
+  const double* y = &features_[(size_t)j * dimension_];
+  double sum = 0;
+  if (cosine_) {
+    for (int k = 0; k < dimension_; k++) sum += x[k] * y[k];
+    return sum;
+  }
+  for (int k = 0; k < dimension_; k++) {
+    double difference = x[k] - y[k];
+    sum += difference * difference;
+  }
+  return exp(-gamma_ * sum);
+}
+
+void FeatureMatrix::SimilarityBlock(const vector<int>& rows,
+                                    const vector<int>& columns,
+                                    vector<double>& block) const {
+  const int d = dimension_;
+  const int num_columns = columns.size();
+  block.resize(rows.size() * columns.size());
+  vector<double> panel((size_t)d * kPanelWidth);
+  for (int c0 = 0; c0 < num_columns; c0 += kPanelWidth) {
+    // Packs up to kPanelWidth columns dimension-major; unused lanes are 0.
+    int width = std::min(kPanelWidth, num_columns - c0);
+    for (int c = 0; c < kPanelWidth; c++) {
+      for (int k = 0; k < d; k++) {
+        panel[k * kPanelWidth + c] = c < width ?
+            features_[(size_t)columns[c0 + c] * d + k] : 0;
+      }
+    }
+    for (int r = 0; r < (int)rows.size(); r++) {
+      const double* x = &features_[(size_t)rows[r] * d];
+      double acc[kPanelWidth] = {0};
+      if (cosine_) {
+        for (int k = 0; k < d; k++) {
+          const double* p = &panel[k * kPanelWidth];
+          for (int c = 0; c < kPanelWidth; c++) acc[c] += x[k] * p[c];
+        }
+      } else {
+        for (int k = 0; k < d; k++) {
+          const double* p = &panel[k * kPanelWidth];
+          for (int c = 0; c < kPanelWidth; c++) {
+            double difference = x[k] - p[c];
+            acc[c] += difference * difference;
+          }
+        }
+      }
+      double* out = &block[(size_t)r * num_columns + c0];
+      for (int c = 0; c < width; c++) {
+        out[c] = cosine_ ? acc[c] : exp(-gamma_ * acc[c]);
+      }
+    }
+  }
+}
+
+void FeatureMatrix::ColumnSums(const vector<int>& columns,
+                               vector<double>& sums) const {
+  sums.assign(columns.size(), 0);
+  if (cosine_) {
+    // The kernel is linear in each argument, so one dot product suffices.
+    for (int c = 0; c < (int)columns.size(); c++) {
+      const double* y = &features_[(size_t)columns[c] * dimension_];
+      double sum = 0;
+      for (int k = 0; k < dimension_; k++) sum += feature_sum_[k] * y[k];
+      sums[c] = sum;
+    }
+    return;
+  }
+  vector<int> rows, chunk;
+  vector<double> block;
+  for (int c0 = 0; c0 < (int)columns.size(); c0 += kBlockSize) {
+    int c1 = std::min((int)columns.size(), c0 + kBlockSize);
+    chunk.assign(columns.begin() + c0, columns.begin() + c1);
+    for (int i0 = 0; i0 < num_nodes_; i0 += kBlockSize) {
+      rows.clear();
+      for (int i = i0; i < std::min(num_nodes_, i0 + kBlockSize); i++) {
+        rows.push_back(i);
+      }
+      SimilarityBlock(rows, chunk, block);
+      for (int r = 0; r < (int)rows.size(); r++) {
+        for (int c = c0; c < c1; c++) {
+          sums[c] += block[(size_t)r * chunk.size() + c - c0];
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef FEATURE_MATRIX_H_
+#define FEATURE_MATRIX_H_
+
+#include <string>
+#include <vector>
+
+// Similarity matrix defined by one feature vector per element and computed
+// on demand, so memory is O(nd) instead of O(n^2).
+//
+// File format: a header line "n d kernel [gamma]" followed by n lines of d
+// values. kernel is "cosine" (dot products of the normalized vectors) or
+// "rbf" (exp(-gamma * |x - y|^2)).
+class FeatureMatrix {
+ public:
+  // Rows and columns per SimilarityBlock call in the blocked kernels.
+  static const int kBlockSize = 256;
+
+  explicit FeatureMatrix(std::string filename);
+
+  bool is_open() const { return num_nodes_ > 0; }
+  int num_nodes() const { return num_nodes_; }
+  int dimension() const { return dimension_; }
+  std::string kernel() const { return kernel_; }
+
+  double Similarity(int i, int j) const;
+  // block[r * columns.size() + c] = Similarity(rows[r], columns[c]). The
+  // columns are packed into panels so the inner loops run over contiguous
+  // memory with a fixed trip count, which the compiler vectorizes. Every
+  // entry is summed in the same order as in Similarity.
+  void SimilarityBlock(const std::vector<int>& rows,
+                       const std::vector<int>& columns,
+                       std::vector<double>& block) const;
+  // sums[c] = sum over all elements i of Similarity(i, columns[c]). Takes
+  // O(d) per column for the cosine kernel.
+  void ColumnSums(const std::vector<int>& columns,
+                  std::vector<double>& sums) const;
+
+ private:
+  int num_nodes_;
+  int dimension_;
+  std::string kernel_;
+  bool cosine_;
+  double gamma_;
+  std::vector<double> features_;  // Row-major n x d
+  std::vector<double> feature_sum_;  // Sum of the (normalized) rows
+};
+
+#endif  // FEATURE_MATRIX_H_
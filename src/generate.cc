@@ -0,0 +1,68 @@
+// Writes seeded synthetic inputs for scaling studies (see generators.h).
+//
+// Usage:
+//   ./generate erdos_renyi n p seed output
+//   ./generate stochastic_block_model n blocks p q seed output
+//   ./generate chung_lu n exponent average_degree seed output
+//   ./generate embeddings n dimension clusters kernel seed output
+//
+// Graphs are for graph_cut and revenue, embeddings for image_summarization
+// and movie_recommendation. An output ending in .edges is a binary edge
+// list, one ending in .features (embeddings only) a FeatureMatrix file, and
+// anything else a text edge list. Set NUM_THREADS in the environment to
+// limit the number of threads.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "generators.h"
+
+using std::atof;
+using std::atoi;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+int main(int argc, char* argv[]) {
+  vector<string> args(argv + 1, argv + argc);
+  const char* threads_variable = getenv("NUM_THREADS");
+  int num_threads = threads_variable ? atoi(threads_variable) : 0;
+  string model = args.empty() ? "" : args[0];
+  auto start = std::chrono::steady_clock::now();
+  bool written = false;
+  if (model == "erdos_renyi" && args.size() == 5) {
+    written = WriteErdosRenyi(args[4], atoi(args[1].c_str()),
+        atof(args[2].c_str()), atoi(args[3].c_str()), num_threads);
+  } else if (model == "stochastic_block_model" && args.size() == 7) {
+    written = WriteStochasticBlockModel(args[6], atoi(args[1].c_str()),
+        atoi(args[2].c_str()), atof(args[3].c_str()), atof(args[4].c_str()),
+        atoi(args[5].c_str()), num_threads);
+  } else if (model == "chung_lu" && args.size() == 6) {
+    written = WriteChungLu(args[5], atoi(args[1].c_str()),
+        atof(args[2].c_str()), atof(args[3].c_str()), atoi(args[4].c_str()),
+        num_threads);
+  } else if (model == "embeddings" && args.size() == 7) {
+    written = WriteRandomEmbeddings(args[6], atoi(args[1].c_str()),
+        atoi(args[2].c_str()), atoi(args[3].c_str()), args[4],
+        atoi(args[5].c_str()), num_threads);
+  } else {
+    cerr << "usage: " << argv[0] << " erdos_renyi n p seed output" << endl;
+    cerr << "       " << argv[0];
+    cerr << " stochastic_block_model n blocks p q seed output" << endl;
+    cerr << "       " << argv[0];
+    cerr << " chung_lu n exponent average_degree seed output" << endl;
+    cerr << "       " << argv[0];
+    cerr << " embeddings n dimension clusters kernel seed output" << endl;
+    return 1;
+  }
+  if (!written) return 1;
+  std::chrono::duration<double> seconds =
+      std::chrono::steady_clock::now() - start;
+  cout << "wrote " << args.back() << " in " << seconds.count() << " s";
+  cout << endl;
+  return 0;
+}
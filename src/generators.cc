@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "edge_list.h"
+#include "generators.h"
+
+using std::cerr;
+using std::endl;
+using std::max;
+using std::min;
+using std::mt19937;
+using std::mt19937_64;
+using std::ofstream;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Rows per separately seeded chunk. It is fixed so that the output does not
+// depend on the number of threads.
+const int kChunkRows = 256;
+
+bool HasSuffix(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Appends the edges of row i to edges, drawing from rng.
+typedef std::function<void(int, mt19937_64&, vector<Edge>&)> RowGenerator;
+
+bool WriteRows(const string& filename, int n, unsigned seed, int num_threads,
+               const RowGenerator& generate_row) {
+  EdgeListWriter writer(filename, n);
+  if (!writer.is_open()) return false;
+  if (num_threads <= 0) {
+    num_threads = max(1, (int)std::thread::hardware_concurrency());
+  }
+  int num_chunks = (n + kChunkRows - 1) / kChunkRows;
+  // Chunks are generated and encoded in batches of a few per thread, then
+  // written in order.
+  int batch_size = 4 * num_threads;
+  vector<string> bytes(batch_size);
+  vector<long long> counts(batch_size);
+  for (int first = 0; first < num_chunks; first += batch_size) {
+    int last = min(num_chunks, first + batch_size);
+    auto work = [&](int thread) {
+      vector<Edge> edges;
+      for (int c = first + thread; c < last; c += num_threads) {
+        std::seed_seq seeds{seed, (unsigned)c};
+        mt19937_64 rng(seeds);
+        edges.clear();
+        for (int i = c * kChunkRows; i < min(n, (c + 1) * kChunkRows); i++) {
+          generate_row(i, rng, edges);
+        }
+        bytes[c - first].clear();
+        EdgeListWriter::Encode(edges, writer.binary(), bytes[c - first]);
+        counts[c - first] = edges.size();
+      }
+    };
+    vector<std::thread> workers;
+    for (int t = 1; t < num_threads; t++) workers.emplace_back(work, t);
+    work(0);
+    for (auto& worker : workers) worker.join();
+    for (int c = first; c < last; c++) {
+      writer.Write(bytes[c - first], counts[c - first]);
+    }
+  }
+  return writer.Close();
+}
+
+void AddUndirectedEdge(int i, int j, vector<Edge>& edges) {
+  edges.push_back(Edge{i, j, 1});
+  edges.push_back(Edge{j, i, 1});
+}
+
+// Adds an undirected edge from i to each j in [begin, end) with probability
+// p, jumping over the non-edges with geometrically distributed skips.
+void SampleRange(int i, int begin, int end, double p, mt19937_64& rng,
+                 vector<Edge>& edges) {
+  if (p <= 0) return;
+  std::uniform_real_distribution<double> uniform(0, 1);
+  double log_q = std::log1p(-p);
+  for (long long j = begin; j < end; j++) {
+    if (p < 1) {
+      double skip = std::floor(std::log(1 - uniform(rng)) / log_q);
+      if (j + skip >= end) break;
+      j += (long long)skip;
+    }
+    AddUndirectedEdge(i, j, edges);
+  }
+}
+
+}  // namespace
+
+bool WriteRandomGraph(const string& filename, int n, int out_degree,
+                      unsigned seed) {
+  ofstream file(filename);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return false;
+  }
+  mt19937 rng(seed);
+  std::uniform_int_distribution<int> node(0, n - 1);
+  std::uniform_real_distribution<double> weight(0, 1);
+  file << n << " " << (long long)n * out_degree << "\n";
+  for (int i = 0; i < n; i++) {
+    for (int d = 0; d < out_degree; d++) {
+      file << i << " " << node(rng) << " " << 1 - weight(rng) << "\n";
+    }
+  }
+  return (bool)file;
+}
+
+bool WriteRandomSimilarities(const string& filename, int n, int dimension,
+                             unsigned seed) {
+  ofstream file(filename);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return false;
+  }
+  mt19937 rng(seed);
+  std::uniform_real_distribution<double> coordinate(0, 1);
+  vector<double> points((size_t)n * dimension);
+  for (auto& x : points) x = coordinate(rng);
+  file.precision(6);
+  file << n << " " << (long long)n * n << "\n";
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      double distance = 0;
+      for (int k = 0; k < dimension; k++) {
+        double difference = points[(size_t)i * dimension + k] -
+                            points[(size_t)j * dimension + k];
+        distance += difference * difference;
+      }
+      file << i << " " << j << " " << std::exp(-distance / dimension) << "\n";
+    }
+  }
+  return (bool)file;
+}
+
+bool WriteErdosRenyi(const string& filename, int n, double p, unsigned seed,
+                     int num_threads) {
+  return WriteRows(filename, n, seed, num_threads,
+      [&](int i, mt19937_64& rng, vector<Edge>& edges) {
+    SampleRange(i, i + 1, n, p, rng, edges);
+  });
+}
+
+bool WriteStochasticBlockModel(const string& filename, int n, int num_blocks,
+                               double p, double q, unsigned seed,
+                               int num_threads) {
+  vector<int> block_ends(num_blocks);
+  for (int b = 0; b < num_blocks; b++) {
+    block_ends[b] = (long long)(b + 1) * n / num_blocks;
+  }
+  return WriteRows(filename, n, seed, num_threads,
+      [&](int i, mt19937_64& rng, vector<Edge>& edges) {
+    int block_end = *std::upper_bound(block_ends.begin(), block_ends.end(), i);
+    SampleRange(i, i + 1, block_end, p, rng, edges);
+    SampleRange(i, block_end, n, q, rng, edges);
+  });
+}
+
+bool WriteChungLu(const string& filename, int n, double exponent,
+                  double average_degree, unsigned seed, int num_threads) {
+  // Expected degrees w_i proportional to (i + 1)^(-1 / (exponent - 1)),
+  // which follow the power law and are decreasing.
+  vector<double> weights(n);
+  double total = 0;
+  for (int i = 0; i < n; i++) {
+    weights[i] = std::pow(i + 1.0, -1 / (exponent - 1));
+    total += weights[i];
+  }
+  for (auto& w : weights) w *= n * average_degree / total;
+  total = n * average_degree;
+  return WriteRows(filename, n, seed, num_threads,
+      [&](int i, mt19937_64& rng, vector<Edge>& edges) {
+    // Miller and Hagberg: skips are drawn for the largest remaining
+    // probability, which is that of the next node, and then thinned.
+    std::uniform_real_distribution<double> uniform(0, 1);
+    long long j = i + 1;
+    double p = j < n ? min(1.0, weights[i] * weights[j] / total) : 0;
+    while (j < n && p > 0) {
+      if (p < 1) {
+        double skip = std::floor(std::log(1 - uniform(rng)) /
+                                 std::log1p(-p));
+        if (j + skip >= n) break;
+        j += (long long)skip;
+      }
+      double q = min(1.0, weights[i] * weights[j] / total);
+      if (uniform(rng) < q / p) AddUndirectedEdge(i, j, edges);
+      p = q;
+      j++;
+    }
+  });
+}
+
+bool WriteRandomEmbeddings(const string& filename, int n, int dimension,
+                           int num_clusters, const string& kernel,
+                           unsigned seed, int num_threads) {
+  if (kernel != "cosine" && kernel != "rbf") {
+    cerr << "unknown kernel: " << kernel << endl;
+    return false;
+  }
+  mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> coordinate(0, 1);
+  std::normal_distribution<double> noise(0, 0.1);
+  vector<double> centers((size_t)max(num_clusters, 0) * dimension);
+  for (auto& x : centers) x = coordinate(rng);
+  vector<double> points((size_t)n * dimension);
+  for (int i = 0; i < n; i++) {
+    double* x = &points[(size_t)i * dimension];
+    if (num_clusters <= 0) {
+      for (int k = 0; k < dimension; k++) x[k] = coordinate(rng);
+      continue;
+    }
+    int cluster = std::uniform_int_distribution<int>(0, num_clusters - 1)(rng);
+    const double* center = &centers[(size_t)cluster * dimension];
+    for (int k = 0; k < dimension; k++) x[k] = center[k] + noise(rng);
+  }
+  bool cosine = kernel == "cosine";
+  double gamma = 1.0 / dimension;
+  if (HasSuffix(filename, ".features")) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+      cerr << "filepath does not exist: " << filename << endl;
+      return false;
+    }
+    file.precision(10);
+    file << n << " " << dimension << " " << kernel;
+    if (!cosine) file << " " << gamma;
+    file << "\n";
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < dimension; k++) {
+        file << (k ? " " : "") << points[(size_t)i * dimension + k];
+      }
+      file << "\n";
+    }
+    return (bool)file;
+  }
+  if (cosine) {
+    for (int i = 0; i < n; i++) {
+      double* x = &points[(size_t)i * dimension];
+      double norm = 0;
+      for (int k = 0; k < dimension; k++) norm += x[k] * x[k];
+      norm = std::sqrt(norm);
+      if (norm > 0) {
+        for (int k = 0; k < dimension; k++) x[k] /= norm;
+      }
+    }
+  }
+  return WriteRows(filename, n, seed, num_threads,
+      [&](int i, mt19937_64& /*rng*/, vector<Edge>& edges) {
+    const double* x = &points[(size_t)i * dimension];
+    for (int j = 0; j < n; j++) {
+      const double* y = &points[(size_t)j * dimension];
+      double sum = 0;
+      for (int k = 0; k < dimension; k++) {
+        sum += cosine ? x[k] * y[k] : (x[k] - y[k]) * (x[k] - y[k]);
+      }
+      edges.push_back(Edge{i, j, cosine ? sum : std::exp(-gamma * sum)});
+    }
+  });
+}
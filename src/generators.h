@@ -0,0 +1,54 @@
+#ifndef GENERATORS_H_
+#define GENERATORS_H_
+
+#include <string>
+
+// Seeded random inputs in the edge list format read by EvaluationOracle, for
+// benchmarks and scaling studies that must not depend on the data sets in
+// data/.
+
+// Directed graph on n nodes with out_degree random out-edges per node and
+// weights uniform in (0, 1], for graph_cut and revenue.
+bool WriteRandomGraph(const std::string& filename, int n, int out_degree,
+                      unsigned seed);
+
+// Complete similarity matrix exp(-|x_i - x_j|^2 / dimension) of n random
+// points in the unit cube, for image_summarization and
+// movie_recommendation.
+bool WriteRandomSimilarities(const std::string& filename, int n,
+                             int dimension, unsigned seed);
+
+// The generators below write a binary edge list if filename ends in .edges
+// and a text one otherwise (see edge_list.h). Rows are generated on
+// num_threads threads (all hardware threads if <= 0) in fixed chunks that
+// are seeded separately, so the output only depends on the seed. Graphs are
+// undirected, with unit weights and both directions of every edge.
+
+// Erdos-Renyi graph G(n, p).
+bool WriteErdosRenyi(const std::string& filename, int n, double p,
+                     unsigned seed, int num_threads=0);
+
+// Stochastic block model with num_blocks blocks of consecutive nodes and
+// nearly equal sizes, and edge probability p within a block and q across.
+bool WriteStochasticBlockModel(const std::string& filename, int n,
+                               int num_blocks, double p, double q,
+                               unsigned seed, int num_threads=0);
+
+// Chung-Lu graph whose expected degrees follow a power law with the given
+// exponent (> 2) and average: node i gets an edge to node j with
+// probability min(1, w_i w_j / sum(w)), where w_i is the expected degree.
+bool WriteChungLu(const std::string& filename, int n, double exponent,
+                  double average_degree, unsigned seed, int num_threads=0);
+
+// n random embeddings in dimension dimensions, normally distributed with
+// standard deviation 0.1 around num_clusters centers drawn uniformly from
+// the unit cube (uniform in the cube if num_clusters <= 0). kernel is
+// "cosine" or "rbf" (with gamma = 1 / dimension). Writes a FeatureMatrix
+// file if filename ends in .features, and the complete similarity matrix
+// as an edge list otherwise.
+bool WriteRandomEmbeddings(const std::string& filename, int n,
+                           int dimension, int num_clusters,
+                           const std::string& kernel, unsigned seed,
+                           int num_threads=0);
+
+#endif  // GENERATORS_H_
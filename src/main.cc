@@ -2,9 +2,14 @@
 
 #include "adaptive_maximization.h"
 #include "blits.h"
+#include "budget.h"
+#include "distributed.h"
 #include "evaluation_oracle.h"
 #include "fantom.h"
+#include "oracle_accuracy.h"
+#include "pruning.h"
 #include "random_greedy.h"
+#include "streaming.h"
 #include "maximization_result.h"
 #include "utilities.h"
 
@@ -14,6 +19,25 @@ int main() {
   auto oracle = EvaluationOracle(input_filename, "image_summarization");
   std::string output_path = "output/image-summarization/images_500_graph/";
 
+  /*
+  // Out-of-core image summarization: convert once with
+  //   ./make_tiles images_500_graph.txt images_500_graph.tiles
+  // and the oracle reads tiles from disk through a bounded cache.
+  std::string input_filename = "data/image-summarization/images_500_graph.tiles";
+  int size_constraint = 80;
+  auto oracle = EvaluationOracle(input_filename, "image_summarization");
+  std::string output_path = "output/image-summarization/images_500_graph/";
+  */
+
+  /*
+  // Similarities computed on demand from one feature vector per element
+  // (header "n d cosine" or "n d rbf gamma", then n rows of d values).
+  std::string input_filename = "data/movie-recommendation/movies_500.features";
+  int size_constraint = 250;
+  auto oracle = EvaluationOracle(input_filename, "movie_recommendation");
+  std::string output_path = "output/movie-recommendation/movies_500/";
+  */
+
   /*
   std::string input_filename = "data/movie-recommendation/movies_graph_500.txt";
   int size_constraint = 250;
@@ -28,10 +52,26 @@ int main() {
   std::string output_path = "output/youtube-revenue/youtube_graph_1329/";
   */
 
+  /*
+  // Synthetic graphs for scaling studies, written once with e.g.
+  //   ./generate erdos_renyi 1000 0.5 1 data/erdos-renyi/erdos_renyi-n_1000-p_50.edges
+  //   ./generate stochastic_block_model 700 7 0.8 0 1 data/stochastic-block-model/stochastic_block_model-n_700-c_7-p_80-q_0.edges
+  std::string input_filename = "data/erdos-renyi/erdos_renyi-n_1000-p_50.edges";
+  int size_constraint = 500;
+  auto oracle = EvaluationOracle(input_filename, "graph_cut");
+  std::string output_path = "output/erdos-renyi/erdos_renyi-n_1000-p_50/";
+  */
+
   std::cout << "Running: " << input_filename << std::endl;
   std::cout << "with cardinality constraint: " << size_constraint << std::endl;
   std::cout << std::endl;
 
+  // Records the queries of the runs below for ./replay, which times them on
+  // other backends and thread counts.
+  //QueryTraceWriter trace(output_path + "queries.qtr", oracle.num_nodes(),
+  //                       oracle.function_name());
+  //oracle.set_query_trace(&trace);
+
   TestRandom(oracle, size_constraint, output_path);
   TestRandomPrefix(oracle, size_constraint, output_path);
   TestGreedy(oracle, size_constraint, output_path);
@@ -41,12 +81,49 @@ int main() {
   const double delta = 0.1;
   const int rounds = 10;
 
+  // Linear double greedy instead of random subsets for the unconstrained
+  // stage of the adaptive algorithm and FANTOM.
+  //auto result = Fantom(oracle, size_constraint, epsilon, false, Budget(),
+  //                     UnconstrainedMethod::kDoubleGreedy);
+
   TestRandomLazyGreedyImproved(oracle, size_constraint, output_path);
   TestAdaptiveNonmonotoneMaximization(oracle, size_constraint, epsilon, delta, output_path);
   //TestAdaptiveMaximization(oracle, size_constraint, epsilon, delta, output_path);
   
   TestBlits(oracle, size_constraint, rounds, epsilon, output_path);
   TestFantom(oracle, size_constraint, epsilon, output_path);
+  //TestSieveStreaming(oracle, size_constraint, epsilon, output_path);
+
+  // Anytime runs stop once the budget (seconds, queries) is exhausted and
+  // return the best feasible solution found so far.
+  //Budget budget(oracle, 60.0, 1000000);
+  //auto result = Fantom(oracle, size_constraint, epsilon, false, budget);
+
+  // Runs on the elements with f({u}) > 0 only, sharing one parallel
+  // singleton scan; e.g. for any algorithm above:
+  //auto result = RunPruned(oracle, [&](const EvaluationOracle& pruned) {
+  //  return Greedy(pruned, size_constraint);
+  //});
+  //TestPruning(oracle, size_constraint, epsilon, delta, output_path);
+
+  // Cardinality sweeps that share work across all constraints.
+  //const std::vector<int> size_constraints = {20, 40, 60, 80, 100};
+  //TestGreedySweep(oracle, size_constraints, output_path);
+  //TestAdaptiveNonmonotoneMaximizationSweep(oracle, size_constraints, epsilon, delta, output_path);
+  //TestFantomSweep(oracle, size_constraints, epsilon, output_path);
+
+  // Accuracy of kNN-sparsified similarity matrices, e.g. before switching to
+  // oracle.Sparsify(neighbors) for larger catalogs.
+  //TestSparsification(oracle, size_constraint, {5, 10, 20, 50}, output_path);
+
+  // Accuracy of row-sampled image summarization coverage, e.g. before
+  // switching to oracle.SampleCoverageRows(sample_size) for larger catalogs.
+  //TestCoverageSampling(oracle, size_constraint, {100, 1000, 10000}, epsilon,
+  //                     delta, output_path);
+
+  // Two-round partitioned runs with one worker process per shard.
+  //const int num_shards = 4;
+  //TestRandGreeDI(oracle, size_constraint, num_shards, "greedy", epsilon, delta, output_path);
 
   return 0;
 }
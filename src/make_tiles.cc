@@ -0,0 +1,37 @@
+// Converts a similarity matrix in the edge list format read by
+// EvaluationOracle into the memory-mapped tiled format of TiledMatrix, so
+// that image summarization can run on matrices that do not fit in memory.
+//
+// Usage: ./make_tiles input.txt output.tiles [tile_size]
+//
+// The input may also be a binary edge list (input.edges).
+//
+// tile_size must be a multiple of 32 (default 256).
+#include <cstdlib>
+#include <iostream>
+
+#include "tiled_matrix.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3 || argc > 4) {
+    cerr << "usage: " << argv[0] << " input.txt output.tiles [tile_size]";
+    cerr << endl;
+    return 1;
+  }
+  int tile_size = TiledMatrix::kDefaultTileSize;
+  if (argc == 4) tile_size = atoi(argv[3]);
+  if (tile_size <= 0 || tile_size % 32 != 0) {
+    cerr << "tile_size must be a positive multiple of 32" << endl;
+    return 1;
+  }
+  if (!TiledMatrix::Convert(argv[1], argv[2], tile_size)) return 1;
+  TiledMatrix matrix(argv[2]);
+  cout << "nodes: " << matrix.num_nodes() << "\t";
+  cout << "tiles: " << matrix.num_tiles() << " x " << matrix.num_tiles();
+  cout << " of " << matrix.tile_size() << " x " << matrix.tile_size() << endl;
+  return 0;
+}
@@ -1,31 +1,208 @@
+#include <sys/resource.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include "maximization_result.h"
+#include "profiler.h"
 
 using std::cerr;
 using std::endl;
+using std::ifstream;
 using std::ofstream;
+using std::set;
+using std::sort;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char kBinaryMagic[4] = {'M', 'X', 'R', '4'};
+
+OracleCounters (*oracle_counter_source)() = nullptr;
+
+bool HasSuffix(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+long long PeakMemoryKb() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+template <typename T>
+void WriteColumn(ofstream& file, const vector<T>& column) {
+  file.write(reinterpret_cast<const char*>(column.data()),
+             sizeof(T) * column.size());
+}
+
+template <typename T>
+void ReadColumn(ifstream& file, vector<T>& column, int size) {
+  column.resize(size);
+  file.read(reinterpret_cast<char*>(column.data()), sizeof(T) * size);
+}
+
+}  // namespace
+
+void MaximizationResult::set_oracle_counter_source(
+    OracleCounters (*source)()) {
+  oracle_counter_source = source;
+}
+
+OracleCounters MaximizationResult::CurrentOracleCounters() {
+  if (oracle_counter_source == nullptr) return OracleCounters{0, 0, 0};
+  return oracle_counter_source();
+}
 
 MaximizationResult::MaximizationResult() {
   num_rounds = 0;
-  elements_added.resize(1);
+  round_offsets.resize(1);
   marginal_gains.resize(1);
   function_values.resize(1);
   num_queries.resize(1);
+  wall_times.resize(1);
+  oracle_times.resize(1);
+  peak_memory.resize(1);
+  io_bytes.resize(1);
+  value_queries.resize(1);
+  allocations.resize(1);
+  truncated = false;
+  start_time_ = std::chrono::steady_clock::now();
+  OracleCounters counters = CurrentOracleCounters();
+  start_oracle_time_ = counters.query_seconds;
+  start_io_bytes_ = counters.io_bytes;
+  start_value_queries_ = counters.value_queries;
+  start_allocations_ = Profiler::TotalAllocations();
+  peak_memory[0] = PeakMemoryKb();
 }
 
-bool MaximizationResult::Write(std::string filename) {
+void MaximizationResult::AddRound() {
+  num_rounds++;
+  round_offsets.push_back(element_log.size());
+  marginal_gains.push_back(0);
+  function_values.push_back(function_values.back());
+  num_queries.push_back(num_queries.back());
+  wall_times.push_back(0);
+  oracle_times.push_back(0);
+  peak_memory.push_back(0);
+  io_bytes.push_back(0);
+  value_queries.push_back(0);
+  allocations.push_back(0);
+  UpdateRoundStats();
+}
+
+void MaximizationResult::UpdateRoundStats() {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_time_;
+  wall_times[num_rounds] = elapsed.count();
+  OracleCounters counters = CurrentOracleCounters();
+  oracle_times[num_rounds] = counters.query_seconds - start_oracle_time_;
+  peak_memory[num_rounds] = PeakMemoryKb();
+  io_bytes[num_rounds] = counters.io_bytes - start_io_bytes_;
+  value_queries[num_rounds] = counters.value_queries - start_value_queries_;
+  allocations[num_rounds] =
+      Profiler::TotalAllocations() - start_allocations_;
+}
+
+void MaximizationResult::AddElement(int u) {
+  element_log.push_back(u);
+}
+
+void MaximizationResult::SetElementsAdded(const set<int>& T) {
+  element_log.resize(round_offsets[num_rounds]);
+  element_log.insert(element_log.end(), T.begin(), T.end());
+}
+
+int MaximizationResult::NumElementsAdded(int round) const {
+  return ElementsEnd(round) - ElementsBegin(round);
+}
+
+const int* MaximizationResult::ElementsBegin(int round) const {
+  assert(0 <= round && round <= num_rounds);
+  return element_log.data() + round_offsets[round];
+}
+
+const int* MaximizationResult::ElementsEnd(int round) const {
+  assert(0 <= round && round <= num_rounds);
+  if (round == num_rounds) return element_log.data() + element_log.size();
+  return element_log.data() + round_offsets[round + 1];
+}
+
+void MaximizationResult::MapElements(const vector<int>& ids) {
+  for (int& u : element_log) u = ids[u];
+  for (int& u : solution) u = ids[u];
+  sort(solution.begin(), solution.end());
+}
+
+MaximizationResult MaximizationResult::Prefix(int rounds) const {
+  assert(0 <= rounds && rounds <= num_rounds);
+  MaximizationResult prefix = *this;
+  prefix.num_rounds = rounds;
+  prefix.solution.clear();  // How rounds make up a solution is algorithm-specific
+  if (rounds < num_rounds) prefix.element_log.resize(round_offsets[rounds + 1]);
+  prefix.round_offsets.resize(rounds + 1);
+  prefix.marginal_gains.resize(rounds + 1);
+  prefix.function_values.resize(rounds + 1);
+  prefix.num_queries.resize(rounds + 1);
+  prefix.wall_times.resize(rounds + 1);
+  prefix.oracle_times.resize(rounds + 1);
+  prefix.peak_memory.resize(rounds + 1);
+  prefix.io_bytes.resize(rounds + 1);
+  prefix.value_queries.resize(rounds + 1);
+  prefix.allocations.resize(rounds + 1);
+  return prefix;
+}
+
+bool MaximizationResult::Write(string filename) {
+  bool written = false;
+  if (HasSuffix(filename, ".csv")) {
+    written = WriteCsv(filename);
+  } else if (HasSuffix(filename, ".bin")) {
+    written = WriteBinary(filename);
+  } else {
+    written = WriteText(filename);
+  }
+#ifdef ENABLE_PROFILING
+  // Attach the profile collected since the previous Write to this result.
+  Profiler& profiler = Profiler::Get();
+  if (written && !profiler.empty()) {
+    profiler.WriteSummary(filename + ".profile.txt");
+    profiler.WriteChromeTrace(filename + ".trace.json");
+    profiler.Reset();
+  }
+#endif
+  return written;
+}
+
+bool MaximizationResult::WriteText(string filename) {
   ofstream file(filename);
   if (file.is_open()) {
     file << "num_rounds num_elements_added marginal_gains ";
-    file << "function_values num_queries" << std::endl; 
+    file << "function_values num_queries ";
+    file << "wall_times oracle_times peak_memory io_bytes ";
+    file << "value_queries allocations elements_added" << std::endl;
     for (int i = 0; i <= num_rounds; i++) {
       file << i << " ";
-      file << elements_added[i].size() << " ";
+      file << NumElementsAdded(i) << " ";
       file << marginal_gains[i] << " ";
       file << function_values[i] << " ";
-      file << num_queries[i] << std::endl;
+      file << num_queries[i] << " ";
+      file << wall_times[i] << " ";
+      file << oracle_times[i] << " ";
+      file << peak_memory[i] << " ";
+      file << io_bytes[i] << " ";
+      file << value_queries[i] << " ";
+      file << allocations[i] << " ";
+      // The ids of a round form one token, a list literal such as [3,5,7].
+      file << "[";
+      for (const int* u = ElementsBegin(i); u != ElementsEnd(i); u++) {
+        file << (u == ElementsBegin(i) ? "" : ",") << *u;
+      }
+      file << "]" << std::endl;
     }
     return true;
   }
@@ -33,3 +210,136 @@ bool MaximizationResult::Write(std::string filename) {
   assert(false);
   return false;
 }
+
+bool MaximizationResult::WriteCsv(string filename) {
+  ofstream file(filename);
+  if (file.is_open()) {
+    file.precision(17);
+    file << "round,num_elements_added,marginal_gain,function_value,";
+    file << "num_queries,wall_time,oracle_time,peak_memory,io_bytes,";
+    file << "value_queries,allocations,truncated,";
+    file << "elements_added" << std::endl;
+    for (int i = 0; i <= num_rounds; i++) {
+      file << i << ",";
+      file << NumElementsAdded(i) << ",";
+      file << marginal_gains[i] << ",";
+      file << function_values[i] << ",";
+      file << num_queries[i] << ",";
+      file << wall_times[i] << ",";
+      file << oracle_times[i] << ",";
+      file << peak_memory[i] << ",";
+      file << io_bytes[i] << ",";
+      file << value_queries[i] << ",";
+      file << allocations[i] << ",";
+      file << truncated << ",";
+      // Element ids are separated by spaces within the last field.
+      for (const int* u = ElementsBegin(i); u != ElementsEnd(i); u++) {
+        file << (u == ElementsBegin(i) ? "" : " ") << *u;
+      }
+      file << std::endl;
+    }
+    return true;
+  }
+  cerr << "filepath does not exist: " << filename << endl;
+  assert(false);
+  return false;
+}
+
+// Binary layout: the magic "MXR4", int32 number of rows, int32 truncated,
+// then one column per field in row order (int32 sizes, float64 gains,
+// float64 values, int32 queries, float64 wall times, float64 oracle times,
+// int64 peak memory, int64 I/O bytes, int64 Value queries, int64
+// allocations), the element ids as int32 row offsets (rows + 1 of them)
+// followed by the int32 ids, and finally the int32 size of the solution
+// followed by its int32 ids.
+bool MaximizationResult::WriteBinary(string filename) {
+  ofstream file(filename, std::ios::binary);
+  if (file.is_open()) {
+    int32_t num_rows = num_rounds + 1;
+    int32_t is_truncated = truncated;
+    vector<int32_t> sizes, queries, offsets;
+    for (int i = 0; i <= num_rounds; i++) {
+      sizes.push_back(NumElementsAdded(i));
+      queries.push_back(num_queries[i]);
+      offsets.push_back(round_offsets[i]);
+    }
+    offsets.push_back(element_log.size());
+    vector<int32_t> elements(element_log.begin(), element_log.end());
+    vector<int32_t> solution_ids(solution.begin(), solution.end());
+    int32_t solution_size = solution_ids.size();
+    file.write(kBinaryMagic, sizeof(kBinaryMagic));
+    file.write(reinterpret_cast<const char*>(&num_rows), sizeof(num_rows));
+    file.write(reinterpret_cast<const char*>(&is_truncated),
+               sizeof(is_truncated));
+    WriteColumn(file, sizes);
+    WriteColumn(file, marginal_gains);
+    WriteColumn(file, function_values);
+    WriteColumn(file, queries);
+    WriteColumn(file, wall_times);
+    WriteColumn(file, oracle_times);
+    WriteColumn(file, peak_memory);
+    WriteColumn(file, io_bytes);
+    WriteColumn(file, value_queries);
+    WriteColumn(file, allocations);
+    WriteColumn(file, offsets);
+    WriteColumn(file, elements);
+    file.write(reinterpret_cast<const char*>(&solution_size),
+               sizeof(solution_size));
+    WriteColumn(file, solution_ids);
+    return true;
+  }
+  cerr << "filepath does not exist: " << filename << endl;
+  assert(false);
+  return false;
+}
+
+bool MaximizationResult::ReadBinary(string filename) {
+  ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return false;
+  }
+  char magic[4];
+  int32_t num_rows = 0, is_truncated = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&num_rows), sizeof(num_rows));
+  file.read(reinterpret_cast<char*>(&is_truncated), sizeof(is_truncated));
+  if (!file || string(magic, 4) != string(kBinaryMagic, 4) || num_rows < 1) {
+    cerr << "not a binary result file: " << filename << endl;
+    return false;
+  }
+  vector<int32_t> sizes, queries, offsets, elements;
+  ReadColumn(file, sizes, num_rows);
+  ReadColumn(file, marginal_gains, num_rows);
+  ReadColumn(file, function_values, num_rows);
+  ReadColumn(file, queries, num_rows);
+  ReadColumn(file, wall_times, num_rows);
+  ReadColumn(file, oracle_times, num_rows);
+  ReadColumn(file, peak_memory, num_rows);
+  ReadColumn(file, io_bytes, num_rows);
+  ReadColumn(file, value_queries, num_rows);
+  ReadColumn(file, allocations, num_rows);
+  ReadColumn(file, offsets, num_rows + 1);
+  if (!file || offsets.back() < 0) {
+    cerr << "truncated binary result file: " << filename << endl;
+    return false;
+  }
+  ReadColumn(file, elements, offsets.back());
+  int32_t solution_size = 0;
+  file.read(reinterpret_cast<char*>(&solution_size), sizeof(solution_size));
+  vector<int32_t> solution_ids;
+  if (file && solution_size >= 0) {
+    ReadColumn(file, solution_ids, solution_size);
+  }
+  if (!file) {
+    cerr << "truncated binary result file: " << filename << endl;
+    return false;
+  }
+  num_rounds = num_rows - 1;
+  truncated = is_truncated;
+  num_queries.assign(queries.begin(), queries.end());
+  round_offsets.assign(offsets.begin(), offsets.end() - 1);
+  element_log.assign(elements.begin(), elements.end());
+  solution.assign(solution_ids.begin(), solution_ids.end());
+  return true;
+}
@@ -1,18 +1,77 @@
 #ifndef MAXIMIZATION_RESULT_H_
 #define MAXIMIZATION_RESULT_H_
 
+#include <chrono>
 #include <set>
+#include <string>
 #include <vector>
 
+// Process-wide counters of the oracle queries behind a result, as returned
+// by the EvaluationOracle statics of the same names.
+struct OracleCounters {
+  double query_seconds;
+  long long io_bytes;
+  long long value_queries;
+};
+
 struct MaximizationResult {
   MaximizationResult();
+  // The oracle registers where its counters come from, so that programs
+  // that only read result files need not link it. Without a source the
+  // oracle columns are 0.
+  static void set_oracle_counter_source(OracleCounters (*source)());
+  // Writes the result as CSV if filename ends in .csv, as a compact binary
+  // columnar file if it ends in .bin, and as space-separated text otherwise.
+  // Every format includes the elements added in each round.
   bool Write(std::string filename);
+  bool WriteText(std::string filename);
+  bool WriteCsv(std::string filename);
+  bool WriteBinary(std::string filename);
+  bool ReadBinary(std::string filename);
+  // Returns the result truncated after the given round.
+  MaximizationResult Prefix(int rounds) const;
+  // Opens a new round that carries over the previous function value and
+  // query count, and records its timing and memory statistics.
+  void AddRound();
+  // Refreshes the statistics of the current round once its work is done.
+  void UpdateRoundStats();
+  // Elements are kept in an append-only log. Only the current (last) round
+  // can be changed, so earlier rounds are never copied or moved.
+  void AddElement(int u);
+  void SetElementsAdded(const std::set<int>& T);
+  int NumElementsAdded(int round) const;
+  const int* ElementsBegin(int round) const;
+  const int* ElementsEnd(int round) const;
+  // Rewrites element ids through ids, e.g. from a restricted oracle view
+  // back to the ids of the full ground set.
+  void MapElements(const std::vector<int>& ids);
 
   int num_rounds;
-  std::vector<std::set<int>> elements_added;
+  std::vector<int> element_log;    // Elements added, grouped by round
+  std::vector<int> round_offsets;  // Start of each round in element_log
   std::vector<double> marginal_gains;
   std::vector<double> function_values;
   std::vector<int> num_queries;
+  // Cumulative per-round statistics, measured from when the result was
+  // created. Round durations are the differences of consecutive wall_times.
+  std::vector<double> wall_times;
+  std::vector<double> oracle_times;
+  std::vector<long long> peak_memory;  // Peak resident set size in KB
+  std::vector<long long> io_bytes;  // Similarity tiles read from disk
+  std::vector<long long> value_queries;  // Full Value(S) evaluations
+  // Calls to operator new, 0 unless built with COUNT_ALLOCATIONS.
+  std::vector<long long> allocations;
+  bool truncated;  // Stopped early because its Budget was exhausted.
+  std::vector<int> solution;  // Final solution, in increasing order
+
+ private:
+  static OracleCounters CurrentOracleCounters();
+
+  std::chrono::steady_clock::time_point start_time_;
+  double start_oracle_time_;
+  long long start_io_bytes_;
+  long long start_value_queries_;
+  long long start_allocations_;
 };
 
 #endif  // MAXIMIZATION_RESULT_H_
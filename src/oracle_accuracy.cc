@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+
+#include "adaptive_maximization.h"
+#include "oracle_accuracy.h"
+#include "random_greedy.h"
+#include "utilities.h"
+
+using std::cout;
+using std::endl;
+using std::fabs;
+using std::mt19937;
+using std::ofstream;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+double RelativeError(double approximate, double exact) {
+  if (exact == 0) return fabs(approximate);
+  return fabs(approximate - exact) / fabs(exact);
+}
+
+}  // namespace
+
+void TestSparsification(const EvaluationOracle& oracle, int size_constraint,
+    const vector<int>& neighbors, string output_path) {
+  const int RANDOM_SETS = 20;
+  cout << "Running sparsification...\n";
+  // The same random sets for every sparsity level.
+  mt19937 rng(1);
+  vector<set<int>> random_sets(RANDOM_SETS);
+  vector<double> exact_values(RANDOM_SETS);
+  for (int t = 0; t < RANDOM_SETS; t++) {
+    vector<int> ground_set(oracle.num_nodes());
+    for (int i = 0; i < oracle.num_nodes(); i++) ground_set[i] = i;
+    std::shuffle(ground_set.begin(), ground_set.end(), rng);
+    int size = std::min(size_constraint, oracle.num_nodes());
+    random_sets[t].insert(ground_set.begin(), ground_set.begin() + size);
+    exact_values[t] = oracle.Value(random_sets[t]);
+  }
+  auto exact_start = std::chrono::steady_clock::now();
+  auto exact_result = Greedy(oracle, size_constraint);
+  std::chrono::duration<double> exact_seconds =
+      std::chrono::steady_clock::now() - exact_start;
+
+  string output_filename = output_path;
+  output_filename += "constraint_" + int_to_str(size_constraint) + "-";
+  output_filename += "sparsification.txt";
+  ofstream file(output_filename);
+  file << "neighbors nonzeros mean_random_error max_random_error ";
+  file << "greedy_error greedy_exact_value exact_greedy_value ";
+  file << "greedy_seconds exact_greedy_seconds" << endl;
+  for (auto k : neighbors) {
+    EvaluationOracle sparse_oracle = oracle;
+    sparse_oracle.Sparsify(k);
+    double mean_error = 0, max_error = 0;
+    for (int t = 0; t < RANDOM_SETS; t++) {
+      double error = RelativeError(sparse_oracle.Value(random_sets[t]),
+                                   exact_values[t]);
+      mean_error += error / RANDOM_SETS;
+      max_error = std::max(max_error, error);
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = Greedy(sparse_oracle, size_constraint);
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    set<int> S(result.solution.begin(), result.solution.end());
+    double exact_value = oracle.Value(S);
+    double greedy_error =
+        RelativeError(result.function_values.back(), exact_value);
+    cout << "neighbors: " << k << "\t";
+    cout << "nonzeros: " << sparse_oracle.num_edges() << "\t";
+    cout << "mean error: " << mean_error << "\t";
+    cout << "f(S): " << exact_value << " (exact greedy: ";
+    cout << exact_result.function_values.back() << ")" << endl;
+    file << k << " " << sparse_oracle.num_edges() << " ";
+    file << mean_error << " " << max_error << " " << greedy_error << " ";
+    file << exact_value << " " << exact_result.function_values.back() << " ";
+    file << seconds.count() << " " << exact_seconds.count() << endl;
+  }
+}
+
+void TestCoverageSampling(const EvaluationOracle& oracle, int size_constraint,
+    const vector<int>& sample_sizes, double epsilon, double delta,
+    string output_path) {
+  const int RANDOM_SETS = 20;
+  const double c1 = 1.0/7.0;
+  const double c2 = 1.0;
+  const double c3 = 3.0;
+  cout << "Running coverage sampling...\n";
+  // The same random sets and marginal queries for every sample size.
+  mt19937 rng(1);
+  vector<set<int>> random_sets(RANDOM_SETS);
+  vector<int> random_nodes(RANDOM_SETS);
+  vector<double> exact_values(RANDOM_SETS), exact_marginals(RANDOM_SETS);
+  for (int t = 0; t < RANDOM_SETS; t++) {
+    vector<int> ground_set(oracle.num_nodes());
+    for (int i = 0; i < oracle.num_nodes(); i++) ground_set[i] = i;
+    std::shuffle(ground_set.begin(), ground_set.end(), rng);
+    int size = std::min(size_constraint, oracle.num_nodes() - 1);
+    random_sets[t].insert(ground_set.begin(), ground_set.begin() + size);
+    random_nodes[t] = ground_set[size];
+    exact_values[t] = oracle.Value(random_sets[t]);
+    exact_marginals[t] = oracle.MarginalValue(random_nodes[t], random_sets[t]);
+  }
+  auto exact_start = std::chrono::steady_clock::now();
+  auto exact_result = AdaptiveNonmonotoneMaximization(
+      oracle, size_constraint, epsilon, delta, c1, c2, c3);
+  std::chrono::duration<double> exact_seconds =
+      std::chrono::steady_clock::now() - exact_start;
+  double exact_adaptive_value = exact_result.function_values.back();
+
+  string output_filename = output_path;
+  output_filename += "constraint_" + int_to_str(size_constraint) + "-";
+  output_filename += "coverage_sampling.txt";
+  ofstream file(output_filename);
+  file << "sample_size error_bound mean_value_error max_value_error ";
+  file << "max_marginal_error reevaluations adaptive_exact_value ";
+  file << "exact_adaptive_value adaptive_seconds exact_adaptive_seconds";
+  file << endl;
+  for (auto s : sample_sizes) {
+    EvaluationOracle sampled_oracle = oracle;
+    sampled_oracle.SampleCoverageRows(s);
+    double mean_error = 0, max_error = 0, max_marginal_error = 0;
+    for (int t = 0; t < RANDOM_SETS; t++) {
+      double error = fabs(sampled_oracle.Value(random_sets[t]) -
+                          exact_values[t]);
+      mean_error += error / RANDOM_SETS;
+      max_error = std::max(max_error, error);
+      double marginal = sampled_oracle.MarginalValue(random_nodes[t],
+                                                     random_sets[t]);
+      max_marginal_error = std::max(max_marginal_error,
+                                    fabs(marginal - exact_marginals[t]));
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = AdaptiveNonmonotoneMaximization(
+        sampled_oracle, size_constraint, epsilon, delta, c1, c2, c3);
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    set<int> S(result.solution.begin(), result.solution.end());
+    double exact_value = oracle.Value(S);
+    cout << "sample size: " << s << "\t";
+    cout << "bound: " << sampled_oracle.coverage_error_bound() << "\t";
+    cout << "max error: " << max_error << "\t";
+    cout << "f(S): " << exact_value << " (exact: ";
+    cout << exact_adaptive_value << ")" << endl;
+    file << s << " " << sampled_oracle.coverage_error_bound() << " ";
+    file << mean_error << " " << max_error << " " << max_marginal_error << " ";
+    file << sampled_oracle.num_exact_reevaluations() << " ";
+    file << exact_value << " " << exact_adaptive_value << " ";
+    file << seconds.count() << " " << exact_seconds.count() << endl;
+  }
+}
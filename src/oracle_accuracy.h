@@ -0,0 +1,27 @@
+#ifndef ORACLE_ACCURACY_H_
+#define ORACLE_ACCURACY_H_
+
+#include <string>
+#include <vector>
+
+#include "evaluation_oracle.h"
+
+// Compares sparsified copies of oracle, one per entry of neighbors, against
+// oracle itself: the relative error of f on random sets and on the greedy
+// solution found with the sparse oracle, and how that solution scores under
+// the exact f compared with the exact greedy solution. Writes one line per
+// entry of neighbors to output_path + "sparsification.txt".
+void TestSparsification(const EvaluationOracle& oracle, int size_constraint,
+    const std::vector<int>& neighbors, std::string output_path);
+
+// Compares row-sampled copies of an image summarization oracle, one per
+// entry of sample_sizes, against oracle itself: the Hoeffding bound on the
+// coverage error, the observed error of f on random sets and of marginals
+// on random elements, and the exact value and running time of the adaptive
+// algorithm with threshold checks near tau re-evaluated exactly. Writes one
+// line per sample size to output_path + "coverage_sampling.txt".
+void TestCoverageSampling(const EvaluationOracle& oracle, int size_constraint,
+    const std::vector<int>& sample_sizes, double epsilon, double delta,
+    std::string output_path);
+
+#endif  // ORACLE_ACCURACY_H_
@@ -0,0 +1,163 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+using std::cerr;
+using std::endl;
+using std::ofstream;
+using std::string;
+
+namespace {
+
+// Keeps the Chrome trace bounded; aggregates are always complete.
+const size_t kMaxTraceEvents = 1 << 20;
+
+thread_local long long thread_bytes_allocated = 0;
+std::atomic<long long> total_allocations(0);
+
+}  // namespace
+
+#ifdef COUNT_ALLOCATIONS
+// The byte counts only feed the scopes.
+void* operator new(size_t size) {
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef ENABLE_PROFILING
+  thread_bytes_allocated += size;
+#endif
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef ENABLE_PROFILING
+  thread_bytes_allocated += size;
+#endif
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+#endif  // COUNT_ALLOCATIONS
+
+Profiler::Profiler()
+    : epoch_(std::chrono::steady_clock::now()), dropped_events_(0) {}
+
+Profiler& Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+long long Profiler::ThreadBytesAllocated() {
+  return thread_bytes_allocated;
+}
+
+long long Profiler::TotalAllocations() {
+  return total_allocations.load(std::memory_order_relaxed);
+}
+
+int Profiler::Register(const char* name, bool traced) {
+  // Scopes with the same name share one entry.
+  for (int id = 0; id < (int)stats_.size(); id++) {
+    if (stats_[id].name == name) return id;
+  }
+  ProfileStat stat;
+  stat.name = name;
+  stat.traced = traced;
+  stat.count = 0;
+  stat.seconds = 0;
+  stat.bytes_allocated = 0;
+  stats_.push_back(stat);
+  return stats_.size() - 1;
+}
+
+void Profiler::Record(int id, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end,
+                      long long bytes_allocated) {
+  assert(0 <= id && id < (int)stats_.size());
+  std::chrono::duration<double> elapsed = end - start;
+  ProfileStat& stat = stats_[id];
+  stat.count++;
+  stat.seconds += elapsed.count();
+  stat.bytes_allocated += bytes_allocated;
+  if (!stat.traced) return;
+  if (events_.size() >= kMaxTraceEvents) {
+    dropped_events_++;
+    return;
+  }
+  std::chrono::duration<double, std::micro> start_us = start - epoch_;
+  std::chrono::duration<double, std::micro> duration_us = end - start;
+  TraceEvent event;
+  event.id = id;
+  event.start_us = start_us.count();
+  event.duration_us = duration_us.count();
+  event.bytes_allocated = bytes_allocated;
+  events_.push_back(event);
+}
+
+void Profiler::Reset() {
+  // Registered scopes keep their ids.
+  for (auto& stat : stats_) {
+    stat.count = 0;
+    stat.seconds = 0;
+    stat.bytes_allocated = 0;
+  }
+  events_.clear();
+  dropped_events_ = 0;
+  epoch_ = std::chrono::steady_clock::now();
+}
+
+bool Profiler::empty() const {
+  for (const auto& stat : stats_) {
+    if (stat.count > 0) return false;
+  }
+  return true;
+}
+
+bool Profiler::WriteSummary(string filename) const {
+  ofstream file(filename);
+  if (file.is_open()) {
+    file << "scope count seconds bytes_allocated" << endl;
+    for (const auto& stat : stats_) {
+      if (stat.count == 0) continue;
+      file << stat.name << " " << stat.count << " " << stat.seconds << " ";
+      file << stat.bytes_allocated << endl;
+    }
+    return true;
+  }
+  cerr << "filepath does not exist: " << filename << endl;
+  return false;
+}
+
+bool Profiler::WriteChromeTrace(string filename) const {
+  ofstream file(filename);
+  if (file.is_open()) {
+    file << std::fixed;
+    file.precision(3);
+    file << "{\"traceEvents\":[" << endl;
+    for (size_t i = 0; i < events_.size(); i++) {
+      const TraceEvent& event = events_[i];
+      file << "{\"name\":\"" << stats_[event.id].name << "\",";
+      file << "\"ph\":\"X\",\"pid\":0,\"tid\":0,";
+      file << "\"ts\":" << event.start_us << ",";
+      file << "\"dur\":" << event.duration_us << ",";
+      file << "\"args\":{\"bytes_allocated\":" << event.bytes_allocated;
+      file << "}}" << (i + 1 < events_.size() ? "," : "") << endl;
+    }
+    file << "],\"otherData\":{\"dropped_events\":" << dropped_events_;
+    file << "}}" << endl;
+    return true;
+  }
+  cerr << "filepath does not exist: " << filename << endl;
+  return false;
+}
@@ -0,0 +1,96 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Low-overhead scoped timers for algorithm phases and oracle methods. All
+// instrumentation compiles out unless ENABLE_PROFILING is defined (build with
+// `make PROFILE=1`). For every named scope the profiler records the number of
+// calls, wall time and bytes allocated on the calling thread. Traced scopes
+// are also kept as events for a Chrome trace (chrome://tracing, Perfetto).
+
+// Profiling needs operator new replaced for its byte counts.
+#if defined(ENABLE_PROFILING) && !defined(COUNT_ALLOCATIONS)
+#define COUNT_ALLOCATIONS
+#endif
+
+struct ProfileStat {
+  std::string name;
+  bool traced;
+  long long count;
+  double seconds;
+  long long bytes_allocated;
+};
+
+struct TraceEvent {
+  int id;
+  double start_us;
+  double duration_us;
+  long long bytes_allocated;
+};
+
+class Profiler {
+ public:
+  static Profiler& Get();
+  int Register(const char* name, bool traced);
+  void Record(int id, std::chrono::steady_clock::time_point start,
+              std::chrono::steady_clock::time_point end,
+              long long bytes_allocated);
+  void Reset();
+  bool empty() const;
+  bool WriteSummary(std::string filename) const;
+  bool WriteChromeTrace(std::string filename) const;
+  // Bytes allocated with operator new on this thread since it started.
+  static long long ThreadBytesAllocated();
+  // Calls to operator new on all threads since the program started. Only
+  // counted when COUNT_ALLOCATIONS is defined (`make COUNT_ALLOCATIONS=1`,
+  // implied by PROFILE=1), since replacing operator new costs every thread
+  // an atomic increment per allocation; 0 otherwise.
+  static long long TotalAllocations();
+ private:
+  Profiler();
+  std::chrono::steady_clock::time_point epoch_;
+  std::vector<ProfileStat> stats_;
+  std::vector<TraceEvent> events_;
+  long long dropped_events_;
+};
+
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(int id)
+      : id_(id), bytes_(Profiler::ThreadBytesAllocated()),
+        start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    Profiler::Get().Record(id_, start_, std::chrono::steady_clock::now(),
+                           Profiler::ThreadBytesAllocated() - bytes_);
+  }
+ private:
+  int id_;
+  long long bytes_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILING
+// Aggregated and traced; for algorithm phases.
+#define PROFILE_SCOPE(name) \
+  static const int PROFILE_CONCAT(profile_id_, __LINE__) = \
+      Profiler::Get().Register(name, true); \
+  ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)( \
+      PROFILE_CONCAT(profile_id_, __LINE__))
+// Aggregated only; for oracle methods and other per-query scopes.
+#define PROFILE_HOT_SCOPE(name) \
+  static const int PROFILE_CONCAT(profile_id_, __LINE__) = \
+      Profiler::Get().Register(name, false); \
+  ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)( \
+      PROFILE_CONCAT(profile_id_, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_HOT_SCOPE(name)
+#endif
+
+#endif  // PROFILER_H_
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "adaptive_maximization.h"
+#include "fantom.h"
+#include "pruning.h"
+#include "random_greedy.h"
+#include "utilities.h"
+
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using std::vector;
+
+vector<int> PrunedGroundSet(const EvaluationOracle& oracle) {
+  const vector<double>& singletons = oracle.SingletonValues();
+  vector<int> ground_set;
+  for (int u = 0; u < oracle.num_nodes(); u++) {
+    if (singletons[u] > 0) ground_set.push_back(u);
+  }
+  return ground_set;
+}
+
+MaximizationResult RunPruned(const EvaluationOracle& oracle,
+    const std::function<MaximizationResult(const EvaluationOracle&)>&
+        algorithm) {
+  vector<int> ground_set = PrunedGroundSet(oracle);
+  if (ground_set.empty() || (int)ground_set.size() == oracle.num_nodes()) {
+    return algorithm(oracle);
+  }
+  EvaluationOracle view(oracle, ground_set);
+  MaximizationResult result = algorithm(view);
+  result.MapElements(ground_set);
+  return result;
+}
+
+void TestPruning(const EvaluationOracle& oracle, int size_constraint,
+    double epsilon, double delta, string output_path) {
+  const double c1 = 1.0/7.0;
+  const double c2 = 1.0;
+  const double c3 = 3.0;
+  cout << "Running pruning...\n";
+  const vector<string> names = {"greedy", "random_greedy",
+      "random_lazy_greedy_improved", "adaptive_nonmonotone_maximization",
+      "fantom"};
+  auto run = [&](const string& name, const EvaluationOracle& o) {
+    if (name == "greedy") return Greedy(o, size_constraint);
+    if (name == "random_greedy") return RandomGreedy(o, size_constraint);
+    if (name == "random_lazy_greedy_improved") {
+      const double lazy_epsilon = 0.01;  // As in TestRandomLazyGreedyImproved
+      return RandomLazyGreedyImproved(o, size_constraint, lazy_epsilon);
+    }
+    if (name == "adaptive_nonmonotone_maximization") {
+      return AdaptiveNonmonotoneMaximization(o, size_constraint, epsilon,
+          delta, c1, c2, c3);
+    }
+    return Fantom(o, size_constraint, epsilon);
+  };
+  int pruned_size = PrunedGroundSet(oracle).size();
+
+  string output_filename = output_path;
+  output_filename += "constraint_" + int_to_str(size_constraint) + "-";
+  output_filename += "pruning.txt";
+  ofstream file(output_filename);
+  file << "algorithm num_nodes pruned_num_nodes value pruned_value ";
+  file << "seconds pruned_seconds" << endl;
+  for (const auto& name : names) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = run(name, oracle);
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    auto pruned_result = RunPruned(oracle, [&](const EvaluationOracle& o) {
+      return run(name, o);
+    });
+    std::chrono::duration<double> pruned_seconds =
+        std::chrono::steady_clock::now() - start;
+    cout << name << "\t" << "f(S): " << result.function_values.back();
+    cout << " (pruned to " << pruned_size << ": ";
+    cout << pruned_result.function_values.back() << ")" << endl;
+    file << name << " " << oracle.num_nodes() << " " << pruned_size << " ";
+    file << result.function_values.back() << " ";
+    file << pruned_result.function_values.back() << " ";
+    file << seconds.count() << " " << pruned_seconds.count() << endl;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef PRUNING_H_
+#define PRUNING_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "evaluation_oracle.h"
+#include "maximization_result.h"
+
+// Elements u with f({u}) > 0, in increasing order. By submodularity every
+// other element has a marginal gain <= 0 with respect to any set, so no
+// algorithm needs to consider it.
+std::vector<int> PrunedGroundSet(const EvaluationOracle& oracle);
+
+// Runs algorithm on the view of oracle restricted to PrunedGroundSet(oracle)
+// and maps the result back to the ids of oracle. The singleton values are
+// computed once, in parallel, and shared with the view, so the algorithm's
+// own singleton scans are cache hits. Runs algorithm on oracle itself if
+// nothing would be pruned or nothing would be left.
+MaximizationResult RunPruned(const EvaluationOracle& oracle,
+    const std::function<MaximizationResult(const EvaluationOracle&)>&
+        algorithm);
+
+// Runs each algorithm with and without pruning and writes the ground set
+// sizes, f(S) and running times to
+// output_path + "constraint_<size_constraint>-pruning.txt".
+void TestPruning(const EvaluationOracle& oracle, int size_constraint,
+    double epsilon, double delta, std::string output_path);
+
+#endif  // PRUNING_H_
@@ -0,0 +1,207 @@
+#include "query_trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+using std::back_inserter;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char kTraceMagic[4] = {'M', 'X', 'Q', '1'};
+
+void AppendVarint(string& bytes, uint64_t value) {
+  while (value >= 0x80) {
+    bytes.push_back((char)((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((char)value);
+}
+
+void AppendSortedIds(string& bytes, const vector<int>& ids) {
+  AppendVarint(bytes, ids.size());
+  int previous = 0;
+  for (auto id : ids) {
+    assert(id >= previous);
+    AppendVarint(bytes, id - previous);
+    previous = id;
+  }
+}
+
+void AppendNodes(string& bytes, const vector<int>& nodes) {
+  AppendVarint(bytes, nodes.size());
+  long long previous = 0;
+  for (auto node : nodes) {
+    long long difference = node - previous;
+    AppendVarint(bytes,
+                 difference >= 0 ? 2 * difference : -2 * difference - 1);
+    previous = node;
+  }
+}
+
+}  // namespace
+
+const char* QueryKindName(QueryKind kind) {
+  switch (kind) {
+    case QueryKind::kValue: return "value";
+    case QueryKind::kMarginal: return "marginal";
+    case QueryKind::kSetMarginal: return "set_marginal";
+    case QueryKind::kMarginals: return "marginals";
+    case QueryKind::kSetMarginals: return "set_marginals";
+    case QueryKind::kSingletons: return "singletons";
+  }
+  return "unknown";
+}
+
+QueryTraceWriter::QueryTraceWriter(const string& filename, int num_nodes,
+                                   const string& function_name)
+    : num_queries_(0) {
+  file_.open(filename, std::ios::binary);
+  if (!file_.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return;
+  }
+  int32_t header[2] = {num_nodes, (int32_t)function_name.size()};
+  file_.write(kTraceMagic, sizeof(kTraceMagic));
+  file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+  file_.write(function_name.data(), function_name.size());
+}
+
+void QueryTraceWriter::Add(const Query& query) {
+  if (!file_.is_open()) return;
+  bytes_.clear();
+  bytes_.push_back((char)query.kind);
+  removed_.clear();
+  added_.clear();
+  std::set_difference(S_.begin(), S_.end(), query.S.begin(), query.S.end(),
+                      back_inserter(removed_));
+  std::set_difference(query.S.begin(), query.S.end(), S_.begin(), S_.end(),
+                      back_inserter(added_));
+  AppendSortedIds(bytes_, removed_);
+  AppendSortedIds(bytes_, added_);
+  S_ = query.S;
+  if (query.kind == QueryKind::kMarginal ||
+      query.kind == QueryKind::kMarginals) {
+    AppendNodes(bytes_, query.nodes);
+  } else if (query.kind == QueryKind::kSetMarginal ||
+             query.kind == QueryKind::kSetMarginals) {
+    AppendVarint(bytes_, query.sets.size());
+    for (const auto& T : query.sets) AppendSortedIds(bytes_, T);
+  }
+  char result[sizeof(double)];
+  memcpy(result, &query.result, sizeof(double));
+  bytes_.append(result, sizeof(double));
+  file_.write(bytes_.data(), bytes_.size());
+  num_queries_++;
+}
+
+bool QueryTraceWriter::Close() {
+  if (!file_.is_open()) return false;
+  file_.close();
+  return !file_.fail();
+}
+
+QueryTraceReader::QueryTraceReader(const string& filename)
+    : open_(false), truncated_(false), num_nodes_(0) {
+  file_.open(filename, std::ios::binary);
+  if (!file_.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return;
+  }
+  char magic[4];
+  int32_t header[2] = {0, 0};
+  file_.read(magic, sizeof(magic));
+  file_.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (!file_ || memcmp(magic, kTraceMagic, sizeof(kTraceMagic)) != 0 ||
+      header[0] < 0 || header[1] < 0) {
+    cerr << "not a query trace: " << filename << endl;
+    return;
+  }
+  num_nodes_ = header[0];
+  function_name_.resize(header[1]);
+  file_.read(&function_name_[0], header[1]);
+  if (!file_) {
+    cerr << "not a query trace: " << filename << endl;
+    return;
+  }
+  open_ = true;
+}
+
+bool QueryTraceReader::ReadVarint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = file_.get();
+    if (byte == EOF) return false;
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+bool QueryTraceReader::ReadSortedIds(vector<int>& ids) {
+  uint64_t size = 0, gap = 0;
+  if (!ReadVarint(size)) return false;
+  ids.resize(size);
+  int previous = 0;
+  for (auto& id : ids) {
+    if (!ReadVarint(gap)) return false;
+    id = previous + (int)gap;
+    previous = id;
+  }
+  return true;
+}
+
+bool QueryTraceReader::ReadNodes(vector<int>& nodes) {
+  uint64_t size = 0, code = 0;
+  if (!ReadVarint(size)) return false;
+  nodes.resize(size);
+  long long previous = 0;
+  for (auto& node : nodes) {
+    if (!ReadVarint(code)) return false;
+    long long difference = code & 1 ? -(long long)(code / 2) - 1 : code / 2;
+    node = previous + difference;
+    previous = node;
+  }
+  return true;
+}
+
+bool QueryTraceReader::Next(Query& query) {
+  if (!open_ || truncated_) return false;
+  int kind = file_.get();
+  if (kind == EOF) return false;  // After the last record
+  truncated_ = true;  // Until the record is complete
+  if (kind >= kNumQueryKinds) return false;
+  query.kind = (QueryKind)kind;
+  if (!ReadSortedIds(removed_) || !ReadSortedIds(added_)) return false;
+  kept_.clear();
+  std::set_difference(S_.begin(), S_.end(), removed_.begin(), removed_.end(),
+                      back_inserter(kept_));
+  S_.clear();
+  std::merge(kept_.begin(), kept_.end(), added_.begin(), added_.end(),
+             back_inserter(S_));
+  query.S = S_;
+  query.nodes.clear();
+  query.sets.clear();
+  if (query.kind == QueryKind::kMarginal ||
+      query.kind == QueryKind::kMarginals) {
+    if (!ReadNodes(query.nodes)) return false;
+  } else if (query.kind == QueryKind::kSetMarginal ||
+             query.kind == QueryKind::kSetMarginals) {
+    uint64_t num_sets = 0;
+    if (!ReadVarint(num_sets)) return false;
+    query.sets.resize(num_sets);
+    for (auto& T : query.sets) {
+      if (!ReadSortedIds(T)) return false;
+    }
+  }
+  file_.read(reinterpret_cast<char*>(&query.result), sizeof(double));
+  if (!file_) return false;
+  truncated_ = false;
+  return true;
+}
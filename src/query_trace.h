@@ -0,0 +1,90 @@
+#ifndef QUERY_TRACE_H_
+#define QUERY_TRACE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Oracle queries recorded from an algorithm run (see
+// EvaluationOracle::set_query_trace), so that ./replay can time the same
+// query mix on other backends and thread counts.
+//
+// File layout: the magic "MXQ1", int32 n, the int32 length of the function
+// name and its characters, then one record per query: the uint8 kind, the
+// elements removed from and added to S since the previous record, the
+// operands of the kind and the float64 sum of its results. Numbers are
+// LEB128 varints. An id list is its length followed by the first id and the
+// gaps between consecutive ones, sorted except for the node batches of
+// kMarginals, whose differences are zigzag-encoded. A run that grows S one
+// element at a time thus takes a few bytes per singleton query.
+enum class QueryKind : uint8_t {
+  kValue = 0,  // f(S)
+  kMarginal = 1,  // f(S + node) - f(S)
+  kSetMarginal = 2,  // f(S + T) - f(S)
+  kMarginals = 3,  // A batch of nodes against S
+  kSetMarginals = 4,  // A batch of sets against S
+  kSingletons = 5,  // f({u}) for every node u
+};
+
+const int kNumQueryKinds = 6;
+
+const char* QueryKindName(QueryKind kind);
+
+struct Query {
+  QueryKind kind;
+  std::vector<int> S;  // Sorted
+  // The node of kMarginal or the batch of kMarginals, in query order.
+  std::vector<int> nodes;
+  // The set of kSetMarginal or the batch of kSetMarginals, each sorted.
+  std::vector<std::vector<int>> sets;
+  double result;  // Sum of the results
+};
+
+class QueryTraceWriter {
+ public:
+  QueryTraceWriter(const std::string& filename, int num_nodes,
+                   const std::string& function_name);
+
+  bool is_open() const { return file_.is_open(); }
+  long long num_queries() const { return num_queries_; }
+  // Not thread-safe; queries are recorded in the order they are added.
+  void Add(const Query& query);
+  // Returns false if some write failed.
+  bool Close();
+
+ private:
+  std::ofstream file_;
+  std::vector<int> S_;  // S of the previous record
+  std::vector<int> removed_, added_;
+  std::string bytes_;
+  long long num_queries_;
+};
+
+class QueryTraceReader {
+ public:
+  explicit QueryTraceReader(const std::string& filename);
+
+  bool is_open() const { return open_; }
+  int num_nodes() const { return num_nodes_; }
+  std::string function_name() const { return function_name_; }
+  // Reads the next query. Returns false after the last one or, setting
+  // truncated(), if the file ends within a record.
+  bool Next(Query& query);
+  bool truncated() const { return truncated_; }
+
+ private:
+  bool ReadVarint(uint64_t& value);
+  bool ReadSortedIds(std::vector<int>& ids);
+  bool ReadNodes(std::vector<int>& nodes);
+
+  std::ifstream file_;
+  bool open_;
+  bool truncated_;
+  int num_nodes_;
+  std::string function_name_;
+  std::vector<int> S_;
+  std::vector<int> removed_, added_, kept_;
+};
+
+#endif  // QUERY_TRACE_H_
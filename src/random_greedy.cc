@@ -5,6 +5,7 @@
 #include <set>
 #include <vector>
 
+#include "profiler.h"
 #include "random_greedy.h"
 #include "utilities.h"
 
@@ -16,67 +17,205 @@ using std::max;
 using std::min;
 using std::mt19937;
 using std::pair;
-using std::random_device;
 using std::set;
 using std::sort;
 using std::string;
 using std::uniform_int_distribution;
 using std::vector;
 
+namespace {
+
+// The elements of the ground set bucketed by the thresholds that FillM sweeps,
+// w_j = W (1 - delta)^j for w_j > delta W / k: an element sits on the first
+// level j where its marginal exceeds (1 - delta) w_j, or on none of them.
+// Marginals only shrink as the solution grows, so a marginal from an earlier
+// solution bounds the current one and its level can only move down. FillM
+// then re-evaluates just the stale elements on the levels it reaches.
+class ThresholdLevels {
+ public:
+  ThresholdLevels(const vector<double>& singletons, int size_constraint,
+                  double delta, double W);
+  int num_levels() const { return cutoffs_.size(); }
+  // w_j, and the first w below every level for j == num_levels().
+  double threshold(int j) const { return thresholds_[j]; }
+  // Records a marginal of u with respect to a solution of the given size.
+  void Update(int u, double gain, int solution_size);
+  // Drops u once it is added to the solution.
+  void Remove(int u) { level_[u] = kRemoved; }
+  // Re-evaluates the stale elements on level j that are not in M, moves the
+  // ones that dropped to their new level and returns the number of queries.
+  // Afterwards bucket(j) holds exactly the elements on level j.
+  int Refresh(int j, const EvaluationOracle& oracle, const set<int>& true_S,
+              const set<int>& M);
+  const vector<int>& bucket(int j) const { return buckets_[j]; }
+
+ private:
+  static const int kRemoved = -1;
+  int Level(double gain) const;
+
+  vector<double> thresholds_;
+  vector<double> cutoffs_;  // (1 - delta) w_j
+  vector<vector<int>> buckets_;  // May still list elements that moved down
+  vector<int> level_;  // num_levels() if below every level
+  vector<int> evaluated_at_;  // Solution size of the last marginal
+  vector<int> stale_;
+  vector<double> gains_;
+};
+
+ThresholdLevels::ThresholdLevels(const vector<double>& singletons,
+                                 int size_constraint, double delta, double W) {
+  // Same products as the sweep in FillM used, so levels match it exactly.
+  double w;
+  for (w = W; w > delta*W/size_constraint; w *= (1 - delta)) {
+    thresholds_.push_back(w);
+    cutoffs_.push_back(w*(1 - delta));
+  }
+  thresholds_.push_back(w);
+  buckets_.resize(num_levels());
+  level_.resize(singletons.size());
+  evaluated_at_.assign(singletons.size(), 0);
+  for (int u = 0; u < (int)singletons.size(); u++) {
+    level_[u] = Level(singletons[u]);
+    if (level_[u] < num_levels()) buckets_[level_[u]].push_back(u);
+  }
+}
+
+int ThresholdLevels::Level(double gain) const {
+  return std::partition_point(cutoffs_.begin(), cutoffs_.end(),
+      [gain](double cutoff) { return !(gain > cutoff); }) - cutoffs_.begin();
+}
+
+void ThresholdLevels::Update(int u, double gain, int solution_size) {
+  if (level_[u] == kRemoved) return;
+  evaluated_at_[u] = solution_size;
+  // Rounding can make a marginal grow slightly; levels never move up.
+  int level = max(level_[u], Level(gain));
+  if (level == level_[u]) return;
+  level_[u] = level;
+  if (level < num_levels()) buckets_[level].push_back(u);
+}
+
+int ThresholdLevels::Refresh(int j, const EvaluationOracle& oracle,
+                             const set<int>& true_S, const set<int>& M) {
+  vector<int>& bucket = buckets_[j];
+  stale_.clear();
+  int kept = 0;
+  for (int u : bucket) {
+    if (level_[u] != j) continue;  // Moved down or added to the solution
+    if (evaluated_at_[u] != (int)true_S.size() && !M.count(u)) {
+      stale_.push_back(u);
+    } else {
+      bucket[kept++] = u;
+    }
+  }
+  bucket.resize(kept);
+  if (!stale_.empty()) oracle.MarginalValues(stale_, true_S, gains_);
+  for (int i = 0; i < (int)stale_.size(); i++) {
+    Update(stale_[i], gains_[i], true_S.size());
+    if (level_[stale_[i]] == j) bucket.push_back(stale_[i]);
+  }
+  sort(bucket.begin(), bucket.end());
+  return stale_.size();
+}
+
+// Adds elements to M level by level from the top, in increasing order within
+// a level, until it holds size_constraint elements, padding with fake elements
+// if every level runs out. Sets w to the level it stopped at and returns the
+// number of queries made.
+int FillM(const EvaluationOracle& oracle, const set<int>& S,
+          const set<int>& true_S, set<int>& M, int size_constraint,
+          double& w, ThresholdLevels& levels) {
+  PROFILE_SCOPE("FillM");
+  int num_queries = 0;
+  for (int j = 0; j < levels.num_levels(); j++) {
+    w = levels.threshold(j);
+    num_queries += levels.Refresh(j, oracle, true_S, M);
+    for (int u : levels.bucket(j)) {
+      M.insert(u);
+      if (M.size() == size_constraint) return num_queries;
+    }
+  }
+  w = levels.threshold(levels.num_levels());
+  int ground_set_size = oracle.num_nodes();
+  int new_ground_set_size = ground_set_size + 2*size_constraint;
+  for (int u = ground_set_size; u < new_ground_set_size; u++) {
+    if (S.count(u)) continue;
+    M.insert(u);
+    if (M.size() == size_constraint) return num_queries;
+  }
+  return num_queries;
+}
+
+}  // namespace
+
 MaximizationResult Random(const EvaluationOracle& oracle,
-                          int size_constraint, bool prefix, bool debug) {
+                          int size_constraint, bool prefix, bool debug,
+                          const Budget& budget) {
   const int num_samples = 25;
   MaximizationResult result;
   int ground_set_size = oracle.num_nodes();
-  mt19937 rng; rng.seed(random_device()());
+  mt19937 rng; rng.seed(RandomSeed());
   vector<int> elements(ground_set_size);
   for (int i = 0; i < ground_set_size; i++) elements[i] = i;
   set<int> S;
   double max_function_value = 0;
   int num_queries = 0;
 
-  vector<pair<double, set<int>>> samples(num_samples);
+  // The best set of each sample is a prefix of its shuffled order, so only
+  // that prefix is logged instead of a std::set per sample.
+  vector<pair<double, int>> samples;  // (value, sample index)
+  vector<pair<int, int>> sample_ranges;  // Range of each sample in sample_log
+  vector<int> sample_log;
   for (int r = 0; r < num_samples; r++) {
-    double cur_function_value = 0;
-    set<int> cur_S;
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("Random/sample");
     shuffle(elements.begin(), elements.end(), rng);
     double best_value_for_round = 0;
-    set<int> best_S_for_round;
+    int best_length_for_round = 0;
     if (prefix) {  // Consider prefixes
+      ValueAccumulator cur_S(oracle);
       for (int i = 0; i < ground_set_size; i++) {
-        int x = elements[i];
-        double gain = oracle.MarginalValue(x, cur_S);
+        cur_S.Add(elements[i]);
         num_queries++;
-        cur_S.insert(x);
-        cur_function_value += gain;
-        if (cur_function_value > best_value_for_round) {
-          best_value_for_round = cur_function_value;
-          best_S_for_round = cur_S;
+        if (cur_S.value() > best_value_for_round) {
+          best_value_for_round = cur_S.value();
+          best_length_for_round = cur_S.members().size();
         }
-        if (cur_S.size() >= size_constraint) break;
+        if (cur_S.members().size() >= size_constraint) break;
       }
     } else { // Just take random set of size min(n, k)
-      for (int i = 0; i < min(ground_set_size, size_constraint); i++) {
-        best_S_for_round.insert(elements[i]);
-      }
-      best_value_for_round = oracle.Value(best_S_for_round);
+      // One Value per sample: there is no shorter prefix to share work with.
+      best_length_for_round = min(ground_set_size, size_constraint);
+      set<int> random_S(elements.begin(),
+                        elements.begin() + best_length_for_round);
+      best_value_for_round = oracle.Value(random_S);
     }
-    samples[r].first = best_value_for_round;
-    samples[r].second = best_S_for_round;
+    samples.push_back(make_pair(best_value_for_round, (int)samples.size()));
+    sample_ranges.push_back(make_pair(sample_log.size(),
+        sample_log.size() + best_length_for_round));
+    sample_log.insert(sample_log.end(), elements.begin(),
+                      elements.begin() + best_length_for_round);
   }
+  if (samples.empty()) return result;
   sort(samples.begin(), samples.end());
 
-  max_function_value = samples[num_samples/2].first;
-  S = samples[num_samples/2].second;
+  max_function_value = samples[samples.size()/2].first;
+  auto median_range = sample_ranges[samples[samples.size()/2].second];
+  S.insert(sample_log.begin() + median_range.first,
+           sample_log.begin() + median_range.second);
   // Update maximization results.
-  result.num_rounds = 1;
-  result.elements_added.push_back(S);
-  result.marginal_gains.push_back(max_function_value);
-  result.function_values.push_back(max_function_value);
-  result.num_queries.push_back(num_queries / num_samples);
+  result.AddRound();
+  result.SetElementsAdded(S);
+  result.solution.assign(S.begin(), S.end());
+  result.marginal_gains[result.num_rounds] = max_function_value;
+  result.function_values[result.num_rounds] = max_function_value;
+  result.num_queries[result.num_rounds] = num_queries / (int)samples.size();
   if (debug) {
     cout << result.num_rounds << ":\t";
-    cout << result.elements_added.back().size() << "\t";
+    cout << result.NumElementsAdded(result.num_rounds) << "\t";
     cout << result.function_values.back() << "\t";
     cout << result.marginal_gains.back() << "\t";
     cout << result.num_queries.back() << endl;
@@ -85,23 +224,34 @@ MaximizationResult Random(const EvaluationOracle& oracle,
 }
 
 MaximizationResult Greedy(const EvaluationOracle& oracle,
-                          int size_constraint, bool debug) {
+                          int size_constraint, bool debug,
+                          const Budget& budget) {
   const double k_INF = 1e100;
   MaximizationResult result;
-  mt19937 rng; rng.seed(random_device()());
+  mt19937 rng; rng.seed(RandomSeed());
   int ground_set_size = oracle.num_nodes();
   set<int> S;
-  int num_rounds = 0;
   int num_queries = 0;
   while ((int)S.size() < size_constraint) {
-    num_rounds += 1;
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("Greedy/round");
     // Find maximum marginal gain among all elements not in S.
+    vector<int> remaining;
+    for (int u = 0; u < ground_set_size; u++) {
+      if (!S.count(u)) remaining.push_back(u);
+    }
+    if (remaining.empty()) break;  // E.g. on a pruned ground set
+    vector<double> gains;
+    oracle.MarginalValues(remaining, S, gains);
+    num_queries += remaining.size();
     vector<int> candidates;
     double max_gain = -k_INF;  // INF
-    for (int u = 0; u < ground_set_size; u++) {
-      if (S.count(u)) continue;
-      num_queries += 1;
-      double gain = oracle.MarginalValue(u, S);
+    for (int i = 0; i < (int)remaining.size(); i++) {
+      int u = remaining[i];
+      double gain = gains[i];
       if (gain > max_gain) {
         max_gain = gain;
         candidates.clear();
@@ -114,43 +264,72 @@ MaximizationResult Greedy(const EvaluationOracle& oracle,
     int u = candidates[dist(rng)];
     S.insert(u);
     // Update maximization results.
-    result.num_rounds = num_rounds;
-    set<int> T; T.insert(u);
-    result.elements_added.push_back(T);
-    result.marginal_gains.push_back(max_gain);
-    result.function_values.push_back(result.function_values.back() + max_gain);
-    result.num_queries.push_back(num_queries);
+    result.AddRound();
+    result.AddElement(u);
+    result.marginal_gains[result.num_rounds] = max_gain;
+    result.function_values[result.num_rounds] += max_gain;
+    result.num_queries[result.num_rounds] = num_queries;
     if (debug) {
       cout << result.num_rounds << ":\t";
-      cout << result.elements_added.back().size() << "\t";
+      cout << result.NumElementsAdded(result.num_rounds) << "\t";
       cout << result.function_values.back() << "\t";
       cout << result.marginal_gains.back() << "\t";
       cout << result.num_queries.back() << endl;
     }
   }
+  result.solution.assign(S.begin(), S.end());
   return result;
 }
 
+vector<MaximizationResult> GreedySweep(const EvaluationOracle& oracle,
+                                      const vector<int>& size_constraints,
+                                      bool debug, const Budget& budget) {
+  assert(size_constraints.size() > 0);
+  int max_size_constraint = *std::max_element(size_constraints.begin(),
+                                              size_constraints.end());
+  auto result = Greedy(oracle, max_size_constraint, debug, budget);
+  // Greedy adds exactly one element per round.
+  vector<MaximizationResult> results;
+  for (auto k : size_constraints) {
+    assert(0 <= k);
+    results.push_back(result.Prefix(min(k, result.num_rounds)));
+    MaximizationResult& prefix = results.back();
+    prefix.truncated = k > result.num_rounds;
+    prefix.solution = prefix.element_log;
+    sort(prefix.solution.begin(), prefix.solution.end());
+  }
+  return results;
+}
+
 MaximizationResult RandomGreedy(const EvaluationOracle& oracle,
-                                int size_constraint, bool debug) {
+                                int size_constraint, bool debug,
+                                const Budget& budget) {
   int ground_set_size = oracle.num_nodes();
   MaximizationResult result;
   int new_ground_set_size = ground_set_size + 2*size_constraint;  // Add fakes
-  mt19937 rng; rng.seed(random_device()());
+  mt19937 rng; rng.seed(RandomSeed());
   set<int> S, true_S;
-  int num_rounds = 0;
   int num_queries = 0;
   while ((int)S.size() < size_constraint) {
-    num_rounds += 1;
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("RandomGreedy/round");
+    vector<int> remaining;
+    for (int u = 0; u < ground_set_size; u++) {
+      if (!S.count(u)) remaining.push_back(u);
+    }
+    vector<double> gains;
+    oracle.MarginalValues(remaining, true_S, gains);
+    num_queries += remaining.size();
     vector<pair<double, int>> gains_and_elements;
-    for (int u = 0; u < new_ground_set_size; u++) {
+    for (int i = 0; i < (int)remaining.size(); i++) {
+      gains_and_elements.push_back(make_pair(gains[i], remaining[i]));
+    }
+    for (int u = ground_set_size; u < new_ground_set_size; u++) {
       if (S.count(u)) continue;
-      double gain = 0;  // Default for fake elements
-      if (u < ground_set_size) {
-        gain = oracle.MarginalValue(u, true_S);
-        num_queries += 1;
-      }
-      gains_and_elements.push_back(make_pair(gain, u));
+      gains_and_elements.push_back(make_pair(0.0, u));  // Fake element
     }
     sort(gains_and_elements.begin(), gains_and_elements.end(),
          greater<pair<double, int>>());
@@ -163,44 +342,46 @@ MaximizationResult RandomGreedy(const EvaluationOracle& oracle,
     S.insert(u);
     if (u < ground_set_size) true_S.insert(u);
     // Update maximization results.
-    result.num_rounds = num_rounds;
-    set<int> T;
-    if (u < ground_set_size) T.insert(u);  // Only record original elements.
-    result.elements_added.push_back(T);
-    result.marginal_gains.push_back(gain);
-    result.function_values.push_back(result.function_values.back() + gain);
-    result.num_queries.push_back(num_queries);
+    result.AddRound();
+    if (u < ground_set_size) result.AddElement(u);  // Only record originals.
+    result.marginal_gains[result.num_rounds] = gain;
+    result.function_values[result.num_rounds] += gain;
+    result.num_queries[result.num_rounds] = num_queries;
     if (debug) {
       cout << result.num_rounds << ":\t";
-      cout << result.elements_added.back().size() << "\t";
+      cout << result.NumElementsAdded(result.num_rounds) << "\t";
       cout << result.function_values.back() << "\t";
       cout << result.marginal_gains.back() << "\t";
       cout << result.num_queries.back() << endl;
     }
   }
+  result.solution.assign(true_S.begin(), true_S.end());
   return result;
 }
 
 MaximizationResult RandomLazyGreedyImproved(const EvaluationOracle& oracle,
                                             int size_constraint,
-                                            double delta, bool debug) {
+                                            double delta, bool debug,
+                                            const Budget& budget) {
   // Initialization
   int ground_set_size = oracle.num_nodes();
   MaximizationResult result;
   int new_ground_set_size = ground_set_size + 2*size_constraint;  // Add fakes
-  mt19937 rng; rng.seed(random_device()());
-  int num_rounds = 0;
+  mt19937 rng; rng.seed(RandomSeed());
   int num_queries = 0;
   set<int> S, true_S, M;  // Init empty
   double W = 0, w = 0;
-  for (int u = 0; u < ground_set_size; u++) {
-    W = max(W, oracle.MarginalValue(u, S));
-  }
+  const vector<double>& singletons = oracle.SingletonValues();
+  for (auto gain : singletons) W = max(W, gain);
   num_queries += ground_set_size;  // To compute W
-  FillM(oracle, S, true_S, M, size_constraint, delta, w, W, result, debug);
-  num_queries += ground_set_size;  // To fill M
+  ThresholdLevels levels(singletons, size_constraint, delta, W);
+  num_queries += FillM(oracle, S, true_S, M, size_constraint, w, levels);
   for (int i = 0; i < size_constraint; i++) {
-    num_rounds += 1;
+    if (budget.Exhausted()) {
+      result.truncated = true;
+      break;
+    }
+    PROFILE_SCOPE("RandomLazyGreedyImproved/round");
     vector<int> elements_in_M;
     for (auto u : M) elements_in_M.push_back(u);
     assert((int)elements_in_M.size() >= size_constraint);
@@ -209,14 +390,22 @@ MaximizationResult RandomLazyGreedyImproved(const EvaluationOracle& oracle,
     int u_hat = elements_in_M[idx];
     int u_chosen = -1;
     num_queries++;
-    if (u_hat >= ground_set_size ||
-        oracle.MarginalValue(u_hat, true_S) > (1 - delta)*w) {
+    double u_hat_gain = 0;
+    if (u_hat < ground_set_size) {
+      u_hat_gain = oracle.MarginalValue(u_hat, true_S);
+      levels.Update(u_hat, u_hat_gain, true_S.size());
+    }
+    if (u_hat >= ground_set_size || u_hat_gain > (1 - delta)*w) {
       u_chosen = u_hat;
     } else {
       set<int> new_M;
       for (auto u : M) {
-        if (u < ground_set_size &&
-            oracle.MarginalValue(u, true_S) <= w*(1 - delta)) {
+        double gain = 0;
+        if (u < ground_set_size) {
+          gain = oracle.MarginalValue(u, true_S);
+          levels.Update(u, gain, true_S.size());
+        }
+        if (u < ground_set_size && gain <= w*(1 - delta)) {
           // Remove u from M (implicitly)
           num_queries++;
         } else {
@@ -224,8 +413,7 @@ MaximizationResult RandomLazyGreedyImproved(const EvaluationOracle& oracle,
         }
       }
       M = new_M;
-      FillM(oracle, S, true_S, M, size_constraint, delta, w, W, result, debug);
-      num_queries += ground_set_size;  // To fill M
+      num_queries += FillM(oracle, S, true_S, M, size_constraint, w, levels);
       set<int> M_hat;  // Elements added to M
       for (auto u : M) {
         if (!new_M.count(u)) M_hat.insert(u);
@@ -246,54 +434,26 @@ MaximizationResult RandomLazyGreedyImproved(const EvaluationOracle& oracle,
     if (u_chosen < ground_set_size) {
       gain = oracle.MarginalValue(u_chosen, true_S);
       true_S.insert(u_chosen);
+      levels.Remove(u_chosen);
     }
     // Update maximization results
-    result.num_rounds = num_rounds;
-    set<int> T;
-    if (u_chosen < ground_set_size) T.insert(u_chosen);  // Record originals
-    result.elements_added.push_back(T);
-    result.marginal_gains.push_back(gain);
-    result.function_values.push_back(result.function_values.back() + gain);
-    result.num_queries.push_back(num_queries);
+    result.AddRound();
+    if (u_chosen < ground_set_size) result.AddElement(u_chosen);
+    result.marginal_gains[result.num_rounds] = gain;
+    result.function_values[result.num_rounds] += gain;
+    result.num_queries[result.num_rounds] = num_queries;
     if (debug) {
       cout << result.num_rounds << ":\t";
-      cout << result.elements_added.back().size() << "\t";
+      cout << result.NumElementsAdded(result.num_rounds) << "\t";
       cout << result.function_values.back() << "\t";
       cout << result.marginal_gains.back() << "\t";
       cout << result.num_queries.back() << endl;
     }
   }
+  result.solution.assign(true_S.begin(), true_S.end());
   return result;
 }
 
-void FillM(const EvaluationOracle& oracle, const set<int>& S,
-           const set<int>& true_S, set<int>& M, int size_constraint,
-           double delta, double& w, const double W, MaximizationResult& result,
-           bool debug) {
-  int ground_set_size = oracle.num_nodes();
-  vector<double> current_marginal(ground_set_size);
-  for (int u = 0; u < ground_set_size; u++) {
-    if (S.count(u)) continue;
-    current_marginal[u] = oracle.MarginalValue(u, true_S);
-  }
-  for (w = W; w > delta*W/size_constraint; w *= (1 - delta)) {
-    for (int u = 0; u < ground_set_size; u++) {
-      // If u \in S: continue
-      double gain = current_marginal[u];  // precomputed
-      if (gain > w*(1 - delta)) {
-        M.insert(u);
-        if (M.size() == size_constraint) return;
-      }
-    }
-  }
-  int new_ground_set_size = ground_set_size + 2*size_constraint;
-  for (int u = ground_set_size; u < new_ground_set_size; u++) {
-    if (S.count(u)) continue;
-    M.insert(u);
-    if (M.size() == size_constraint) return;
-  }
-}
-
 void TestRandom(const EvaluationOracle& oracle,
                 int size_constraint, string output_path) {
   const int TRIALS = 10;
@@ -305,7 +465,7 @@ void TestRandom(const EvaluationOracle& oracle,
     string output_filename = output_path;
     output_filename += "constraint_" + int_to_str(size_constraint) + "-";
     output_filename += "random-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
@@ -321,7 +481,7 @@ void TestRandomPrefix(const EvaluationOracle& oracle,
     string output_filename = output_path;
     output_filename += "constraint_" + int_to_str(size_constraint) + "-";
     output_filename += "random_prefix-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
@@ -332,10 +492,22 @@ void TestGreedy(const EvaluationOracle& oracle,
   auto result = Greedy(oracle, size_constraint);
   string output_filename = output_path;
   output_filename += "constraint_" + int_to_str(size_constraint) + "-";
-  output_filename += "greedy.txt";
+  output_filename += "greedy" RESULT_EXTENSION;
   result.Write(output_filename);
 }
 
+void TestGreedySweep(const EvaluationOracle& oracle,
+                     const vector<int>& size_constraints, string output_path) {
+  cout << "Running greedy_sweep...\n";
+  auto results = GreedySweep(oracle, size_constraints);
+  for (int i = 0; i < (int)size_constraints.size(); i++) {
+    string output_filename = output_path;
+    output_filename += "constraint_" + int_to_str(size_constraints[i]) + "-";
+    output_filename += "greedy" RESULT_EXTENSION;
+    results[i].Write(output_filename);
+  }
+}
+
 void TestRandomGreedy(const EvaluationOracle& oracle,
                       int size_constraint, string output_path) {
   const int TRIALS = 10;
@@ -346,7 +518,7 @@ void TestRandomGreedy(const EvaluationOracle& oracle,
     string output_filename = output_path;
     output_filename += "constraint_" + int_to_str(size_constraint) + "-";
     output_filename += "random_greedy-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
@@ -362,7 +534,7 @@ void TestRandomLazyGreedyImproved(const EvaluationOracle& oracle,
     string output_filename = output_path;
     output_filename += "constraint_" + int_to_str(size_constraint) + "-";
     output_filename += "random_lazy_greedy_improved-";
-    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + ".txt";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
     result.Write(output_filename);
   }
 }
@@ -1,23 +1,26 @@
+#include "budget.h"
 #include "evaluation_oracle.h"
 #include "maximization_result.h"
 
 MaximizationResult Random(const EvaluationOracle& oracle, int size_constraint,
-    bool prefix=true, bool debug=false);
+    bool prefix=true, bool debug=false, const Budget& budget=Budget());
 
 MaximizationResult Greedy(const EvaluationOracle& oracle, int size_constraint,
-    bool debug=false);
+    bool debug=false, const Budget& budget=Budget());
+
+// Runs Greedy once for the largest constraint and reads off the result for
+// every other constraint, since greedy solutions are nested prefixes.
+std::vector<MaximizationResult> GreedySweep(const EvaluationOracle& oracle,
+    const std::vector<int>& size_constraints, bool debug=false,
+    const Budget& budget=Budget());
 
 MaximizationResult RandomGreedy(const EvaluationOracle& oracle,
-    int size_constraint, bool debug=false);
+    int size_constraint, bool debug=false, const Budget& budget=Budget());
 
 // Comparing Apples and Oranges: Query Trade-off in Submodular Maximization
 MaximizationResult RandomLazyGreedyImproved(const EvaluationOracle& oracle,
-    int size_constraint, double delta, bool debug=false);
-
-void FillM(const EvaluationOracle& oracle, const std::set<int>& S,
-    const std::set<int>& true_S, std::set<int>& M, int size_constraint,
-    double delta, double& w, const double W, MaximizationResult& result,
-    bool debug=false);
+    int size_constraint, double delta, bool debug=false,
+    const Budget& budget=Budget());
 
 void TestRandom(const EvaluationOracle& oracle,
     int size_constraint, std::string output_path);
@@ -28,6 +31,9 @@ void TestRandomPrefix(const EvaluationOracle& oracle,
 void TestGreedy(const EvaluationOracle& oracle,
     int size_constraint, std::string output_path);
 
+void TestGreedySweep(const EvaluationOracle& oracle,
+    const std::vector<int>& size_constraints, std::string output_path);
+
 void TestRandomGreedy(const EvaluationOracle& oracle,
     int size_constraint, std::string output_path);
 
@@ -0,0 +1,283 @@
+// End-to-end performance regression check: runs every algorithm on fixed,
+// seeded data sets and compares the results with a baseline file.
+//
+// Usage: ./regress baseline.txt [input_dir] [--timing] [--update]
+//
+// The data sets are written to input_dir (default .) on the first run. Each
+// algorithm runs with the same fixed seed on a freshly loaded oracle, so
+// its value, oracle queries and rounds are reproducible and only its wall
+// time and memory depend on the machine. A run regresses if its value
+// drops, or its queries or rounds grow, by more than the tolerances below;
+// the exit status is then 1. Wall time and peak RSS are compared for
+// information only, unless --timing is given: each run is then repeated
+// and its best time must stay within the time tolerances too, as must its
+// peak RSS. With --update the measurements replace the baseline instead,
+// e.g. after an intended change or on new hardware.
+//
+// Baseline format: a header line, then one line per run with
+// "data_set algorithm value num_queries num_rounds wall_seconds peak_kb".
+// The peak resident set size is that of the process so far, not the run's
+// own, so it depends on the runs before it.
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "adaptive_maximization.h"
+#include "blits.h"
+#include "evaluation_oracle.h"
+#include "fantom.h"
+#include "generators.h"
+#include "maximization_result.h"
+#include "random_greedy.h"
+#include "utilities.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::map;
+using std::ofstream;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+const unsigned kSeed = 1;
+
+// Relative tolerances, plus absolute slack for the noisy measurements.
+const double kValueTolerance = 0.01;
+const double kQueryTolerance = 0.05;
+const double kRoundTolerance = 0.05;
+const double kTimeTolerance = 0.5;
+const double kTimeSlackSeconds = 0.25;
+const int kTimingRepetitions = 3;  // With --timing, the best one counts
+const double kMemoryTolerance = 0.25;
+const double kMemorySlackKb = 4096;
+
+struct DataSet {
+  string name;
+  string objective;
+  string filename;
+  int num_nodes;
+  int size_constraint;
+  bool power_law = false;  // A Chung-Lu graph instead of uniform degrees
+};
+
+struct Run {
+  double value = 0;
+  long long num_queries = 0;
+  int num_rounds = 0;
+  double wall_seconds = 0;
+  long long peak_kb = 0;
+};
+
+bool Exists(const string& filename) {
+  ifstream file(filename);
+  return file.is_open();
+}
+
+MaximizationResult RunAlgorithm(const EvaluationOracle& oracle,
+                                const string& algorithm, int k) {
+  const double epsilon = 0.25;
+  const double delta = 0.1;
+  if (algorithm == "greedy") return Greedy(oracle, k);
+  if (algorithm == "random_greedy") return RandomGreedy(oracle, k);
+  if (algorithm == "random_lazy_greedy_improved") {
+    const double lazy_epsilon = 0.01;  // As in TestRandomLazyGreedyImproved
+    return RandomLazyGreedyImproved(oracle, k, lazy_epsilon);
+  }
+  if (algorithm == "adaptive_nonmonotone_maximization") {
+    return AdaptiveNonmonotoneMaximization(oracle, k, epsilon, delta,
+        1.0/7.0, 1.0, 3.0);
+  }
+  if (algorithm == "blits") return Blits(oracle, k, 5, epsilon);
+  return Fantom(oracle, k, epsilon);
+}
+
+// Whether measured exceeds allowed = baseline * (1 + tolerance) + slack,
+// printing the comparison if it does. A comparison that is not enforced is
+// marked as informational.
+bool Exceeds(const string& what, double measured, double baseline,
+             double tolerance, double slack, bool enforced=true) {
+  double allowed = baseline * (1 + tolerance) + slack;
+  if (measured <= allowed) return false;
+  cout << "  " << what << ": " << measured << " > " << allowed;
+  cout << " (baseline " << baseline << ")";
+  if (!enforced) cout << ", for information only";
+  cout << endl;
+  return enforced;
+}
+
+bool ReadBaseline(const string& filename, map<string, Run>& baseline) {
+  ifstream file(filename);
+  if (!file.is_open()) return false;
+  string header;
+  getline(file, header);
+  string data_set, algorithm;
+  Run run;
+  while (file >> data_set >> algorithm >> run.value >> run.num_queries >>
+         run.num_rounds >> run.wall_seconds >> run.peak_kb) {
+    baseline[data_set + " " + algorithm] = run;
+  }
+  return true;
+}
+
+bool WriteBaseline(const string& filename,
+                   const vector<pair<string, Run>>& runs) {
+  ofstream file(filename);
+  if (!file.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+    return false;
+  }
+  file.precision(12);
+  file << "data_set algorithm value num_queries num_rounds wall_seconds ";
+  file << "peak_kb" << endl;
+  for (const auto& key_run : runs) {
+    const Run& run = key_run.second;
+    file << key_run.first << " " << run.value << " " << run.num_queries;
+    file << " " << run.num_rounds << " " << run.wall_seconds << " ";
+    file << run.peak_kb << endl;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  vector<string> args;
+  bool update = false, timing = false;
+  for (int i = 1; i < argc; i++) {
+    if (string(argv[i]) == "--update") {
+      update = true;
+    } else if (string(argv[i]) == "--timing") {
+      timing = true;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.empty() || args.size() > 2) {
+    cerr << "usage: " << argv[0] << " baseline.txt [input_dir] [--timing]";
+    cerr << " [--update]" << endl;
+    return 1;
+  }
+  string baseline_filename = args[0];
+  string input_dir = args.size() == 2 ? args[1] + "/" : "./";
+  // Small enough for the query-hungry algorithms (BLITS) to finish quickly.
+  // graph_cut_small has fewer than 3k nodes, so the adaptive algorithm skips
+  // threshold sampling and maximizes over the whole ground set, whose
+  // skewed degrees leave many singletons below the larger thresholds.
+  const vector<DataSet> data_sets = {
+      {"graph_cut", "graph_cut", input_dir + "regress_graph_200.txt", 200,
+       10},
+      {"revenue", "revenue", input_dir + "regress_graph_50.txt", 50, 5},
+      {"graph_cut_small", "graph_cut", input_dir + "regress_chung_lu_20.txt",
+       20, 10, true},
+      {"image_summarization", "image_summarization",
+       input_dir + "regress_similarity_200.txt", 200, 10},
+      {"movie_recommendation", "movie_recommendation",
+       input_dir + "regress_similarity_200.txt", 200, 10}};
+  const vector<string> algorithms = {"greedy", "random_greedy",
+      "random_lazy_greedy_improved", "adaptive_nonmonotone_maximization",
+      "blits", "fantom"};
+
+  map<string, Run> baseline;
+  if (!update && !ReadBaseline(baseline_filename, baseline)) {
+    cerr << "cannot read baseline " << baseline_filename;
+    cerr << " (create it with --update)" << endl;
+    return 1;
+  }
+  vector<pair<string, Run>> runs;
+  int num_regressions = 0;
+  for (const auto& data_set : data_sets) {
+    if (!Exists(data_set.filename)) {
+      cout << "Writing " << data_set.filename << "..." << endl;
+      bool graph = data_set.objective == "graph_cut" ||
+                   data_set.objective == "revenue";
+      bool written;
+      if (data_set.power_law) {
+        written = WriteChungLu(data_set.filename, data_set.num_nodes, 2.1, 4,
+                               kSeed);
+      } else if (graph) {
+        written = WriteRandomGraph(data_set.filename, data_set.num_nodes, 8,
+                                   kSeed);
+      } else {
+        written = WriteRandomSimilarities(data_set.filename,
+                                          data_set.num_nodes, 16, kSeed);
+      }
+      if (!written) return 1;
+    }
+    for (const auto& algorithm : algorithms) {
+      string key = data_set.name + " " + algorithm;
+      Run run;
+      int repetitions = timing ? kTimingRepetitions : 1;
+      for (int repetition = 0; repetition < repetitions; repetition++) {
+        // A fresh oracle and seed make each run independent of the others.
+        EvaluationOracle oracle(data_set.filename, data_set.objective);
+        if (oracle.num_nodes() != data_set.num_nodes) {
+          cerr << "could not read " << data_set.filename << endl;
+          return 1;
+        }
+        SetRandomSeed(kSeed);
+        // Some algorithms always print their progress.
+        std::streambuf* cout_buffer = cout.rdbuf(nullptr);
+        auto start = std::chrono::steady_clock::now();
+        MaximizationResult result =
+            RunAlgorithm(oracle, algorithm, data_set.size_constraint);
+        std::chrono::duration<double> seconds =
+            std::chrono::steady_clock::now() - start;
+        cout.rdbuf(cout_buffer);
+        // The result only covers the best guess of algorithms that guess
+        // OPT, so queries and time are measured over the whole run instead.
+        run.value = result.function_values.back();
+        run.num_queries = oracle.num_queries();
+        run.num_rounds = result.num_rounds;
+        if (repetition == 0 || seconds.count() < run.wall_seconds) {
+          run.wall_seconds = seconds.count();
+        }
+        run.peak_kb = result.peak_memory.back();
+      }
+      runs.push_back(make_pair(key, run));
+      cout << key << "\tf(S): " << run.value << "\tqueries: ";
+      cout << run.num_queries << "\trounds: " << run.num_rounds;
+      cout << "\tseconds: " << run.wall_seconds << endl;
+      if (update) continue;
+      auto it = baseline.find(key);
+      if (it == baseline.end()) {
+        cout << "  not in the baseline" << endl;
+        continue;
+      }
+      const Run& base = it->second;
+      bool regressed = false;
+      double min_value = base.value - kValueTolerance * fabs(base.value);
+      if (run.value < min_value - 1e-9) {
+        cout << "  value: " << run.value << " < " << min_value;
+        cout << " (baseline " << base.value << ")" << endl;
+        regressed = true;
+      }
+      regressed |= Exceeds("queries", run.num_queries, base.num_queries,
+                           kQueryTolerance, 0);
+      regressed |= Exceeds("rounds", run.num_rounds, base.num_rounds,
+                           kRoundTolerance, 0);
+      regressed |= Exceeds("wall seconds", run.wall_seconds,
+          base.wall_seconds, kTimeTolerance, kTimeSlackSeconds, timing);
+      regressed |= Exceeds("peak KB", run.peak_kb, base.peak_kb,
+                           kMemoryTolerance, kMemorySlackKb, timing);
+      if (regressed) num_regressions++;
+    }
+  }
+  if (update) {
+    if (!WriteBaseline(baseline_filename, runs)) return 1;
+    cout << "Wrote " << runs.size() << " runs to " << baseline_filename;
+    cout << endl;
+    return 0;
+  }
+  cout << num_regressions << " of " << runs.size() << " runs regressed";
+  cout << endl;
+  return num_regressions > 0 ? 1 : 0;
+}
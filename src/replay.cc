@@ -0,0 +1,164 @@
+// Replays an oracle query trace (see query_trace.h) against a backend, to
+// compare backends and thread counts on the query mix of a real run instead
+// of the synthetic queries of bench.
+//
+// Usage: ./replay trace.qtr input_file [--threads N] [--sparsify neighbors]
+//                 [--sample rows]
+//
+// input_file is read by EvaluationOracle with the objective of the trace,
+// e.g. as a dense or symmetric text matrix, .edges, .tiles or .features,
+// and must have the trace's number of nodes. --sparsify and --sample apply
+// Sparsify(neighbors) and SampleCoverageRows(rows) to it first. For each
+// kind of query the tool prints the count, the seconds spent in the oracle,
+// the sum of the results next to the recorded sum, and the largest
+// difference of one query's result from the recorded one, which is 0 on
+// the backend that recorded the trace.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "evaluation_oracle.h"
+#include "query_trace.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct KindStats {
+  long long count = 0;
+  double seconds = 0;
+  double checksum = 0;
+  double recorded_checksum = 0;
+  double max_error = 0;
+};
+
+double Sum(const vector<double>& values) {
+  double sum = 0;
+  for (auto value : values) sum += value;
+  return sum;
+}
+
+void PrintStats(const string& name, const KindStats& stats) {
+  cout << name << "\t" << stats.count << "\t" << stats.seconds << "\t";
+  cout << stats.checksum << "\t" << stats.recorded_checksum << "\t";
+  cout << stats.max_error << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  vector<string> args;
+  int num_threads = 0, neighbors = 0, sample_rows = 0;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (i + 1 < argc && arg == "--threads") {
+      num_threads = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--sparsify") {
+      neighbors = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--sample") {
+      sample_rows = atoi(argv[++i]);
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() != 2) {
+    cerr << "usage: " << argv[0] << " trace.qtr input_file [--threads N]";
+    cerr << " [--sparsify neighbors] [--sample rows]" << endl;
+    return 1;
+  }
+  QueryTraceReader trace(args[0]);
+  if (!trace.is_open()) return 1;
+  EvaluationOracle oracle(args[1], trace.function_name());
+  if (oracle.num_nodes() != trace.num_nodes()) {
+    cerr << args[1] << " has " << oracle.num_nodes() << " nodes, the trace ";
+    cerr << trace.num_nodes() << endl;
+    return 1;
+  }
+  if (num_threads > 0) EvaluationOracle::set_num_threads(num_threads);
+  if (neighbors > 0) oracle.Sparsify(neighbors);
+  if (sample_rows > 0) oracle.SampleCoverageRows(sample_rows);
+  EvaluationOracle::set_query_timing(false);  // Timed here instead
+
+  vector<KindStats> stats(kNumQueryKinds);
+  Query query;
+  set<int> S, T;
+  vector<set<int>> sets;
+  vector<double> values;
+  while (trace.Next(query)) {
+    // Operands are converted before the clock starts.
+    S.clear();
+    S.insert(query.S.begin(), query.S.end());
+    if (query.kind == QueryKind::kSetMarginal) {
+      T.clear();
+      T.insert(query.sets[0].begin(), query.sets[0].end());
+    } else if (query.kind == QueryKind::kSetMarginals) {
+      sets.resize(query.sets.size());
+      for (int t = 0; t < (int)sets.size(); t++) {
+        sets[t].clear();
+        sets[t].insert(query.sets[t].begin(), query.sets[t].end());
+      }
+    }
+    double result = 0;
+    auto start = std::chrono::steady_clock::now();
+    switch (query.kind) {
+      case QueryKind::kValue:
+        result = oracle.Value(S);
+        break;
+      case QueryKind::kMarginal:
+        result = oracle.MarginalValue(query.nodes[0], S);
+        break;
+      case QueryKind::kSetMarginal:
+        result = oracle.MarginalValue(T, S);
+        break;
+      case QueryKind::kMarginals:
+        oracle.MarginalValues(query.nodes, S, values);
+        result = Sum(values);
+        break;
+      case QueryKind::kSetMarginals:
+        oracle.MarginalValues(sets, S, values);
+        result = Sum(values);
+        break;
+      case QueryKind::kSingletons:
+        result = Sum(oracle.SingletonValues());
+        break;
+    }
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    KindStats& kind_stats = stats[(int)query.kind];
+    kind_stats.count++;
+    kind_stats.seconds += seconds.count();
+    kind_stats.checksum += result;
+    kind_stats.recorded_checksum += query.result;
+    kind_stats.max_error =
+        std::max(kind_stats.max_error, std::fabs(result - query.result));
+  }
+  if (trace.truncated()) {
+    cerr << "truncated query trace: " << args[0] << endl;
+    return 1;
+  }
+
+  cout << "kind\tqueries\tseconds\tchecksum\trecorded\tmax_error" << endl;
+  cout.precision(12);
+  KindStats total;
+  for (int kind = 0; kind < kNumQueryKinds; kind++) {
+    if (stats[kind].count == 0) continue;
+    PrintStats(QueryKindName((QueryKind)kind), stats[kind]);
+    total.count += stats[kind].count;
+    total.seconds += stats[kind].seconds;
+    total.checksum += stats[kind].checksum;
+    total.recorded_checksum += stats[kind].recorded_checksum;
+    total.max_error = std::max(total.max_error, stats[kind].max_error);
+  }
+  PrintStats("total", total);
+  return 0;
+}
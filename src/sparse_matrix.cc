@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cassert>
+
+#include "sparse_matrix.h"
+
+using std::vector;
+
+SparseMatrix::SparseMatrix(int num_nodes)
+    : num_nodes_(num_nodes), row_offsets_(1, 0) {}
+
+void SparseMatrix::AddRow(int i, const vector<double>& row, int neighbors,
+                          double threshold) {
+  assert(i == (int)row_offsets_.size() - 1);
+  assert((int)row.size() == num_nodes_);
+  vector<int> kept;
+  for (int j = 0; j < num_nodes_; j++) {
+    if (j != i && row[j] > threshold) kept.push_back(j);
+  }
+  if (neighbors > 0 && (int)kept.size() > neighbors) {
+    // Ties are broken towards smaller indices so the result is deterministic.
+    std::nth_element(kept.begin(), kept.begin() + neighbors, kept.end(),
+        [&](int a, int b) {
+          return row[a] > row[b] || (row[a] == row[b] && a < b);
+        });
+    kept.resize(neighbors);
+  }
+  kept.push_back(i);
+  std::sort(kept.begin(), kept.end());
+  for (auto j : kept) {
+    columns_.push_back(j);
+    values_.push_back(row[j]);
+  }
+  row_offsets_.push_back(columns_.size());
+}
+
+void SparseMatrix::Finish() {
+  assert((int)row_offsets_.size() == num_nodes_ + 1);
+  // Counting sort of the entries by column keeps the rows sorted.
+  column_offsets_.assign(num_nodes_ + 1, 0);
+  for (auto j : columns_) column_offsets_[j + 1]++;
+  for (int j = 0; j < num_nodes_; j++) {
+    column_offsets_[j + 1] += column_offsets_[j];
+  }
+  rows_.resize(columns_.size());
+  column_values_.resize(columns_.size());
+  vector<long long> next(column_offsets_.begin(), column_offsets_.end() - 1);
+  for (int i = 0; i < num_nodes_; i++) {
+    for (long long p = row_offsets_[i]; p < row_offsets_[i + 1]; p++) {
+      long long q = next[columns_[p]]++;
+      rows_[q] = i;
+      column_values_[q] = values_[p];
+    }
+  }
+  column_sums_.assign(num_nodes_, 0);
+  for (int j = 0; j < num_nodes_; j++) {
+    for (long long q = column_offsets_[j]; q < column_offsets_[j + 1]; q++) {
+      column_sums_[j] += column_values_[q];
+    }
+  }
+}
+
+double SparseMatrix::At(int i, int j) const {
+  assert(0 <= i && i < num_nodes_ && 0 <= j && j < num_nodes_);
+  const int* begin = RowIndices(i);
+  const int* end = begin + RowSize(i);
+  const int* it = std::lower_bound(begin, end, j);
+  if (it == end || *it != j) return 0;
+  return RowValues(i)[it - begin];
+}
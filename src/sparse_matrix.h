@@ -0,0 +1,49 @@
+#ifndef SPARSE_MATRIX_H_
+#define SPARSE_MATRIX_H_
+
+#include <vector>
+
+// Sparsified similarity matrix stored both by rows (CSR) and by columns
+// (CSC), with indices sorted within each row and column. Entries that are
+// not stored are zero.
+class SparseMatrix {
+ public:
+  explicit SparseMatrix(int num_nodes);
+
+  // Keeps the entries of row i (given densely) that exceed threshold, at
+  // most the neighbors largest of them if neighbors > 0. The diagonal is
+  // always kept. Rows must be added in increasing order, then Finish called.
+  void AddRow(int i, const std::vector<double>& row, int neighbors,
+              double threshold);
+  void Finish();
+
+  int num_nodes() const { return num_nodes_; }
+  long long num_nonzeros() const { return values_.size(); }
+
+  double At(int i, int j) const;
+  int RowSize(int i) const { return row_offsets_[i + 1] - row_offsets_[i]; }
+  const int* RowIndices(int i) const { return &columns_[row_offsets_[i]]; }
+  const double* RowValues(int i) const { return &values_[row_offsets_[i]]; }
+  int ColumnSize(int j) const {
+    return column_offsets_[j + 1] - column_offsets_[j];
+  }
+  const int* ColumnIndices(int j) const {
+    return &rows_[column_offsets_[j]];
+  }
+  const double* ColumnValues(int j) const {
+    return &column_values_[column_offsets_[j]];
+  }
+  double ColumnSum(int j) const { return column_sums_[j]; }
+
+ private:
+  int num_nodes_;
+  std::vector<long long> row_offsets_;
+  std::vector<int> columns_;
+  std::vector<double> values_;
+  std::vector<long long> column_offsets_;
+  std::vector<int> rows_;
+  std::vector<double> column_values_;
+  std::vector<double> column_sums_;
+};
+
+#endif  // SPARSE_MATRIX_H_
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <set>
+
+#include "profiler.h"
+#include "streaming.h"
+#include "utilities.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::map;
+using std::max;
+using std::mt19937;
+using std::set;
+using std::string;
+using std::vector;
+
+ElementStream::ElementStream(string filename)
+    : file_(filename), from_file_(true), num_nodes_(0), position_(0),
+      shuffle_(false), half_bits_(0) {
+  if (!file_.is_open()) {
+    cerr << "filepath does not exist: " << filename << endl;
+  }
+}
+
+ElementStream::ElementStream(int num_nodes, bool shuffle)
+    : from_file_(false), num_nodes_(num_nodes), position_(0),
+      shuffle_(shuffle), half_bits_(0) {
+  // 4^half_bits_ >= num_nodes, so fewer than 3 of every 4 ids are skipped.
+  while ((1LL << (2 * half_bits_)) < num_nodes) half_bits_++;
+  std::mt19937_64 rng; rng.seed(RandomSeed());
+  for (auto& key : keys_) key = rng();
+}
+
+uint64_t ElementStream::Permute(uint64_t position) const {
+  const uint64_t mask = (1ULL << half_bits_) - 1;
+  uint64_t left = position >> half_bits_, right = position & mask;
+  for (auto key : keys_) {
+    // SplitMix64 finalizer of the right half, keyed per round.
+    uint64_t z = (right ^ key) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    uint64_t next = left ^ (z & mask);
+    left = right;
+    right = next;
+  }
+  return (left << half_bits_) | right;
+}
+
+bool ElementStream::Next(int& element) {
+  if (from_file_) return (bool)(file_ >> element);
+  if (!shuffle_) {
+    if (position_ >= num_nodes_) return false;
+    element = position_++;
+    return true;
+  }
+  const long long end = 1LL << (2 * half_bits_);
+  while (position_ < end) {
+    uint64_t id = Permute(position_++);
+    if (id < (uint64_t)num_nodes_) {
+      element = id;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+// Candidate solution for one guess v of OPT.
+struct StreamingSieve {
+  set<int> S;
+  double value = 0;
+  MaximizationResult result;
+};
+
+}  // namespace
+
+MaximizationResult SieveStreaming(const EvaluationOracle& oracle,
+    ElementStream& stream, int size_constraint, double epsilon,
+    double sample_probability, bool debug, const Budget& budget) {
+  PROFILE_SCOPE("SieveStreaming");
+  mt19937 rng; rng.seed(RandomSeed());
+  std::bernoulli_distribution keep(sample_probability);
+  const int k = size_constraint;
+  set<int> empty_set;
+  double max_singleton = 0;
+  int num_queries = 0;
+  int num_elements = 0;
+  bool truncated = false;
+  map<int, StreamingSieve> sieves;  // Keyed by i for the guess v = (1 + epsilon)^i
+  int u;
+  while (stream.Next(u)) {
+    if (budget.Exhausted()) {
+      truncated = true;
+      break;
+    }
+    num_elements++;
+    if (!keep(rng)) continue;
+    double singleton = oracle.MarginalValue(u, empty_set);
+    num_queries++;
+    if (singleton > max_singleton) {
+      max_singleton = singleton;
+      // Keep exactly the guesses in [max_singleton, 2 k max_singleton].
+      int lo = ceil(log(max_singleton) / log(1 + epsilon));
+      int hi = floor(log(2 * k * max_singleton) / log(1 + epsilon));
+      while (!sieves.empty() && sieves.begin()->first < lo) {
+        sieves.erase(sieves.begin());
+      }
+      for (int i = lo; i <= hi; i++) sieves[i];
+    }
+    for (auto& kv : sieves) {
+      StreamingSieve& sieve = kv.second;
+      if ((int)sieve.S.size() >= k) continue;
+      double v = pow(1 + epsilon, kv.first);
+      double threshold = (v / 2 - sieve.value) / (k - sieve.S.size());
+      double gain = oracle.MarginalValue(u, sieve.S);
+      num_queries++;
+      if (gain < threshold) continue;
+      sieve.S.insert(u);
+      sieve.value += gain;
+      sieve.result.AddRound();
+      sieve.result.AddElement(u);
+      sieve.result.marginal_gains[sieve.result.num_rounds] = gain;
+      sieve.result.function_values[sieve.result.num_rounds] += gain;
+      sieve.result.num_queries[sieve.result.num_rounds] = num_queries;
+    }
+  }
+
+  MaximizationResult result;
+  double best_value = 0;
+  for (auto& kv : sieves) {
+    if (kv.second.value > best_value) {
+      best_value = kv.second.value;
+      result = std::move(kv.second.result);
+      result.solution.assign(kv.second.S.begin(), kv.second.S.end());
+    }
+  }
+  // Final round accounts for the queries made after the last addition.
+  result.AddRound();
+  result.num_queries[result.num_rounds] = num_queries;
+  result.truncated = truncated;
+  if (debug) {
+    cout << "elements: " << num_elements << "\t";
+    cout << "sieves: " << sieves.size() << "\t";
+    cout << "f(S): " << result.function_values.back() << "\t";
+    cout << "queries: " << num_queries << endl;
+  }
+  return result;
+}
+
+void TestSieveStreaming(const EvaluationOracle& oracle, int size_constraint,
+                        double epsilon, string output_path) {
+  const int TRIALS = 10;
+  cout << "Running sieve_streaming...\n";
+  for (int trial = 1; trial <= TRIALS; trial++) {
+    cout << " - trial: " << trial << "/" << TRIALS << endl;
+    const double sample_probability = 0.5;
+    const bool debug = true;
+    ElementStream stream(oracle.num_nodes(), true);
+    auto result = SieveStreaming(oracle, stream, size_constraint, epsilon,
+        sample_probability, debug);
+    string output_filename = output_path;
+    output_filename += "constraint_" + int_to_str(size_constraint) + "-";
+    output_filename += "epsilon_" + int_to_str(100*epsilon) + "-";
+    output_filename += "sieve_streaming-";
+    output_filename += "trial_" + int_to_str(trial) + "_" + int_to_str(TRIALS) + RESULT_EXTENSION;
+    result.Write(output_filename);
+  }
+}
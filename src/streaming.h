@@ -0,0 +1,54 @@
+#ifndef STREAMING_H_
+#define STREAMING_H_
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "budget.h"
+#include "evaluation_oracle.h"
+#include "maximization_result.h"
+
+// Source of ground set elements for one-pass algorithms. Ids are read one at
+// a time from a whitespace-separated file, or produced from 0..n-1, so the
+// element input is never held in full. The random order of a shuffled
+// stream is a seeded Feistel permutation of the next power of 4 at least n,
+// with the ids >= n skipped, so it takes O(1) memory as well.
+class ElementStream {
+ public:
+  explicit ElementStream(std::string filename);
+  ElementStream(int num_nodes, bool shuffle);
+  // False if the file could not be opened.
+  bool is_open() const { return !from_file_ || file_.is_open(); }
+  bool Next(int& element);
+ private:
+  static const int kFeistelRounds = 4;
+
+  // The position-th id of the shuffled order, before skipping ids >= n.
+  uint64_t Permute(uint64_t position) const;
+
+  std::ifstream file_;
+  bool from_file_;
+  int num_nodes_;
+  long long position_;
+  bool shuffle_;
+  int half_bits_;  // Each Feistel half has this many bits
+  uint64_t keys_[kFeistelRounds];
+};
+
+// One-pass sieve-streaming for cardinality constraints. Each element is kept
+// with probability sample_probability before it reaches the sieves; this
+// subsampling is what makes thresholding work for non-monotone objectives.
+// Keeps one candidate set per guess of OPT in (1 + epsilon)^i, for
+// O(k log k / epsilon) candidates in total.
+MaximizationResult SieveStreaming(const EvaluationOracle& oracle,
+    ElementStream& stream, int size_constraint, double epsilon,
+    double sample_probability, bool debug=false,
+    const Budget& budget=Budget());
+
+void TestSieveStreaming(const EvaluationOracle& oracle, int size_constraint,
+    double epsilon, std::string output_path);
+
+#endif  // STREAMING_H_
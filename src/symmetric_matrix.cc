@@ -0,0 +1,28 @@
+#include "symmetric_matrix.h"
+
+using std::vector;
+
+bool SymmetricMatrix::IsSymmetric(const vector<vector<double>>& matrix) {
+  int n = matrix.size();
+  for (int i = 0; i < n; i++) {
+    if ((int)matrix[i].size() != n) return false;
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      if (matrix[i][j] != matrix[j][i]) return false;
+    }
+  }
+  return true;
+}
+
+SymmetricMatrix::SymmetricMatrix(vector<vector<double>>& matrix)
+    : num_nodes_(matrix.size()) {
+  values_.reserve((long long)num_nodes_ * (num_nodes_ + 1) / 2);
+  column_sums_.assign(num_nodes_, 0);
+  for (int i = 0; i < num_nodes_; i++) {
+    const vector<double>& row = matrix[i];
+    values_.insert(values_.end(), row.begin() + i, row.end());
+    for (int j = 0; j < num_nodes_; j++) column_sums_[j] += row[j];
+    vector<double>().swap(matrix[i]);
+  }
+}
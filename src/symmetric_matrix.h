@@ -0,0 +1,37 @@
+#ifndef SYMMETRIC_MATRIX_H_
+#define SYMMETRIC_MATRIX_H_
+
+#include <vector>
+
+// Symmetric n x n matrix of doubles that stores only its upper triangle,
+// packed row by row, in n(n + 1)/2 entries.
+class SymmetricMatrix {
+ public:
+  // Whether matrix is square and equal to its transpose.
+  static bool IsSymmetric(const std::vector<std::vector<double>>& matrix);
+
+  // Packs the upper triangle of a symmetric matrix, releasing the memory of
+  // each of its rows once it is copied.
+  explicit SymmetricMatrix(std::vector<std::vector<double>>& matrix);
+
+  int num_nodes() const { return num_nodes_; }
+  long long num_entries() const { return values_.size(); }
+
+  double At(int i, int j) const {
+    return i <= j ? UpperRow(i)[j] : UpperRow(j)[i];
+  }
+  // UpperRow(i)[j] = At(i, j) for j >= i, contiguous in memory.
+  const double* UpperRow(int i) const {
+    return values_.data() + (long long)i * num_nodes_ -
+           (long long)i * (i + 1) / 2;
+  }
+  // Sum over all rows i, in increasing order, of At(i, j).
+  double ColumnSum(int j) const { return column_sums_[j]; }
+
+ private:
+  int num_nodes_;
+  std::vector<double> values_;
+  std::vector<double> column_sums_;
+};
+
+#endif  // SYMMETRIC_MATRIX_H_
@@ -0,0 +1,153 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "edge_list.h"
+#include "tiled_matrix.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+namespace {
+
+const char kTiledMagic[4] = {'M', 'X', 'T', '1'};
+// Keeps the tiles page-aligned so that single tiles can be dropped.
+const size_t kHeaderBytes = 4096;
+
+long long total_bytes_read = 0;
+
+struct TiledHeader {
+  char magic[4];
+  int32_t num_nodes;
+  int32_t tile_size;
+  int32_t unused;
+  int64_t num_edges;
+};
+
+}  // namespace
+
+bool TiledMatrix::Convert(string input_filename, string output_filename,
+                          int tile_size) {
+  // Tiles of 32 x 32 doubles or multiples are a whole number of pages.
+  assert(tile_size > 0 && tile_size % 32 == 0);
+  EdgeListReader input(input_filename);
+  if (!input.is_open()) {
+    cerr << "filepath does not exist: " << input_filename << endl;
+    return false;
+  }
+  long long num_nodes = input.num_nodes(), num_edges = input.num_edges();
+  long long num_tiles = (num_nodes + tile_size - 1) / tile_size;
+  size_t tile_bytes = sizeof(double) * tile_size * tile_size;
+  size_t file_bytes = kHeaderBytes + num_tiles * num_tiles * tile_bytes;
+  int fd = open(output_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    cerr << "cannot create: " << output_filename << endl;
+    return false;
+  }
+  // The file starts out sparse and all zero, so only nonzeros are written.
+  if (ftruncate(fd, file_bytes) != 0) {
+    close(fd);
+    return false;
+  }
+  char* data = static_cast<char*>(
+      mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  TiledHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kTiledMagic, sizeof(kTiledMagic));
+  header.num_nodes = num_nodes;
+  header.tile_size = tile_size;
+  header.num_edges = num_edges;
+  memcpy(data, &header, sizeof(header));
+  double* tiles = reinterpret_cast<double*>(data + kHeaderBytes);
+  Edge edge;
+  while (input.Next(edge)) {
+    assert(0 <= edge.from && edge.from < num_nodes);
+    assert(0 <= edge.to && edge.to < num_nodes);
+    long long tile = (edge.from / tile_size) * num_tiles + edge.to / tile_size;
+    long long offset = (edge.from % tile_size) * tile_size +
+                       edge.to % tile_size;
+    tiles[tile * tile_size * tile_size + offset] = edge.weight;
+  }
+  bool ok = input.done();
+  munmap(data, file_bytes);
+  return ok;
+}
+
+TiledMatrix::TiledMatrix(string filename, int cache_tiles)
+    : num_nodes_(0), num_edges_(0), tile_size_(0), num_tiles_(0),
+      tile_bytes_(0), file_bytes_(0), data_(nullptr),
+      cache_tiles_(cache_tiles), last_tile_(-1), bytes_read_(0) {
+  assert(cache_tiles_ > 0);
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  TiledHeader header;
+  struct stat file_stat;
+  if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+      memcmp(header.magic, kTiledMagic, sizeof(kTiledMagic)) != 0 ||
+      fstat(fd, &file_stat) != 0) {
+    cerr << "not a tiled matrix file: " << filename << endl;
+    close(fd);
+    return;
+  }
+  num_nodes_ = header.num_nodes;
+  num_edges_ = header.num_edges;
+  tile_size_ = header.tile_size;
+  num_tiles_ = (num_nodes_ + tile_size_ - 1) / tile_size_;
+  tile_bytes_ = sizeof(double) * tile_size_ * tile_size_;
+  file_bytes_ = kHeaderBytes + (size_t)num_tiles_ * num_tiles_ * tile_bytes_;
+  assert((size_t)file_stat.st_size >= file_bytes_);
+  void* data = mmap(nullptr, file_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    num_nodes_ = 0;
+    return;
+  }
+  data_ = static_cast<char*>(data);
+  madvise(data_, file_bytes_, MADV_RANDOM);
+  lru_position_.resize((size_t)num_tiles_ * num_tiles_);
+  resident_.assign((size_t)num_tiles_ * num_tiles_, 0);
+}
+
+TiledMatrix::~TiledMatrix() {
+  if (data_ != nullptr) munmap(data_, file_bytes_);
+}
+
+const double* TiledMatrix::Tile(int tile_row, int tile_column) const {
+  assert(0 <= tile_row && tile_row < num_tiles_);
+  assert(0 <= tile_column && tile_column < num_tiles_);
+  int id = tile_row * num_tiles_ + tile_column;
+  char* tile = data_ + kHeaderBytes + id * tile_bytes_;
+  if (id == last_tile_) return reinterpret_cast<const double*>(tile);
+  last_tile_ = id;
+  if (resident_[id]) {
+    lru_.splice(lru_.begin(), lru_, lru_position_[id]);
+    return reinterpret_cast<const double*>(tile);
+  }
+  if ((int)lru_.size() == cache_tiles_) {
+    int victim = lru_.back();
+    lru_.pop_back();
+    resident_[victim] = 0;
+    // The pages are read back from the file if the tile is used again.
+    madvise(data_ + kHeaderBytes + victim * tile_bytes_, tile_bytes_,
+            MADV_DONTNEED);
+  }
+  lru_.push_front(id);
+  lru_position_[id] = lru_.begin();
+  resident_[id] = 1;
+  bytes_read_ += tile_bytes_;
+  ::total_bytes_read += tile_bytes_;
+  return reinterpret_cast<const double*>(tile);
+}
+
+long long TiledMatrix::total_bytes_read() {
+  return ::total_bytes_read;
+}
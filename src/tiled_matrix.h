@@ -0,0 +1,70 @@
+#ifndef TILED_MATRIX_H_
+#define TILED_MATRIX_H_
+
+#include <list>
+#include <string>
+#include <vector>
+
+// Read-only n x n matrix of doubles stored on disk as square tiles and
+// memory-mapped. At most cache_tiles tiles are kept resident: the least
+// recently used tile is dropped from memory when a new one is loaded, so the
+// working set stays bounded no matter how large n is. Not thread-safe.
+//
+// File layout: a 4096-byte header (the magic "MXT1", int32 n, int32 tile
+// size, int64 number of edges), then the tiles in row-major order of tiles,
+// each tile_size x tile_size doubles in row-major order, zero-padded at the
+// right and bottom edges.
+class TiledMatrix {
+ public:
+  static const int kDefaultTileSize = 256;
+  static const int kDefaultCacheTiles = 256;
+
+  // Converts a matrix in an edge list format read by EvaluationOracle (text
+  // or binary .edges) to the tiled format. The input is streamed and never
+  // held in memory.
+  static bool Convert(std::string input_filename,
+                      std::string output_filename,
+                      int tile_size=kDefaultTileSize);
+
+  explicit TiledMatrix(std::string filename,
+                       int cache_tiles=kDefaultCacheTiles);
+  ~TiledMatrix();
+  TiledMatrix(const TiledMatrix&) = delete;
+  TiledMatrix& operator=(const TiledMatrix&) = delete;
+
+  bool is_open() const { return data_ != nullptr; }
+  int num_nodes() const { return num_nodes_; }
+  long long num_edges() const { return num_edges_; }
+  int tile_size() const { return tile_size_; }
+  int num_tiles() const { return num_tiles_; }  // Along each dimension
+
+  // Row-major tile_size x tile_size block starting at entry
+  // (tile_row * tile_size, tile_column * tile_size).
+  const double* Tile(int tile_row, int tile_column) const;
+  double At(int i, int j) const {
+    const double* tile = Tile(i / tile_size_, j / tile_size_);
+    return tile[(i % tile_size_) * tile_size_ + j % tile_size_];
+  }
+
+  // Bytes of tiles loaded into the cache by this matrix and by all of them.
+  long long bytes_read() const { return bytes_read_; }
+  static long long total_bytes_read();
+
+ private:
+  int num_nodes_;
+  long long num_edges_;
+  int tile_size_;
+  int num_tiles_;
+  size_t tile_bytes_;
+  size_t file_bytes_;
+  char* data_;
+  int cache_tiles_;
+  // Least recently used tile at the back.
+  mutable std::list<int> lru_;
+  mutable std::vector<std::list<int>::iterator> lru_position_;
+  mutable std::vector<char> resident_;
+  mutable int last_tile_;
+  mutable long long bytes_read_;
+};
+
+#endif  // TILED_MATRIX_H_
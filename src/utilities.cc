@@ -1,9 +1,17 @@
+#include <random>
 #include <sstream>
 #include "utilities.h"
 
 using std::string;
 using std::stringstream;
 
+namespace {
+
+bool fixed_seed = false;
+std::mt19937 seed_sequence;
+
+}  // namespace
+
 string int_to_str(int n) {
   stringstream ss;
   ss << n;
@@ -11,3 +19,13 @@ string int_to_str(int n) {
   ss >> ans;
   return ans;
 }
+
+unsigned RandomSeed() {
+  if (fixed_seed) return seed_sequence();
+  return std::random_device()();
+}
+
+void SetRandomSeed(unsigned seed) {
+  fixed_seed = true;
+  seed_sequence.seed(seed);
+}
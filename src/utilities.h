@@ -1 +1,16 @@
+#include <string>
+
+// Extension of the result files written by the Test* drivers. It selects the
+// format in MaximizationResult::Write; build with `make RESULT_FORMAT=csv` or
+// `make RESULT_FORMAT=bin` to change it.
+#ifndef RESULT_EXTENSION
+#define RESULT_EXTENSION ".txt"
+#endif
+
 std::string int_to_str(int n);
+
+// Seed for the random number generators of the algorithms: fresh from
+// std::random_device, unless SetRandomSeed fixed the sequence of seeds so
+// that runs can be reproduced.
+unsigned RandomSeed();
+void SetRandomSeed(unsigned seed);
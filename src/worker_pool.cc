@@ -0,0 +1,66 @@
+#include "worker_pool.h"
+
+using std::mutex;
+using std::unique_lock;
+
+WorkerPool& WorkerPool::Get() {
+  static WorkerPool pool;
+  return pool;
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    unique_lock<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void WorkerPool::Dispatch(int num_tasks, TaskFunction function,
+                          void* context) {
+  if (num_tasks <= 1 || busy_.exchange(true)) {
+    for (int t = 0; t < num_tasks; t++) function(context, t);
+    return;
+  }
+  {
+    unique_lock<mutex> lock(mutex_);
+    while ((int)threads_.size() < num_tasks - 1) {
+      threads_.emplace_back(&WorkerPool::Work, this);
+    }
+    function_ = function;
+    context_ = context;
+    next_task_ = 1;
+    num_tasks_ = num_tasks;
+    pending_ = num_tasks - 1;
+  }
+  wake_.notify_all();
+  function(context, 0);
+  unique_lock<mutex> lock(mutex_);
+  RunClaimedTasks(lock);
+  done_.wait(lock, [this] { return pending_ == 0; });
+  function_ = nullptr;
+  context_ = nullptr;
+  busy_ = false;
+}
+
+void WorkerPool::RunClaimedTasks(unique_lock<mutex>& lock) {
+  while (next_task_ < num_tasks_) {
+    int t = next_task_++;
+    TaskFunction function = function_;
+    void* context = context_;
+    lock.unlock();
+    function(context, t);
+    lock.lock();
+    if (--pending_ == 0) done_.notify_one();
+  }
+}
+
+void WorkerPool::Work() {
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this] { return stop_ || next_task_ < num_tasks_; });
+    if (stop_) return;
+    RunClaimedTasks(lock);
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that stay alive between parallel oracle queries, so that a query
+// split over several threads pays for a wake-up rather than for starting
+// and joining each thread. Run(num_tasks, task) calls task(t) for t = 0,
+// ..., num_tasks - 1: task 0 on the calling thread, which then also takes
+// over tasks no worker has claimed yet, and returns when all of them are
+// done. The pool grows to num_tasks - 1 threads on first use.
+//
+// One Run is served at a time. A Run that finds the pool busy, because
+// another thread or an enclosing task is running one, calls its tasks in
+// order on the calling thread instead of waiting for it.
+//
+// A child process made by fork() inherits the pool without its threads,
+// and possibly with its mutex locked by one of them, so it must not call
+// Run with more than one task (see EvaluationOracle::set_num_threads).
+class WorkerPool {
+ public:
+  static WorkerPool& Get();
+
+  template <typename Task>
+  void Run(int num_tasks, Task& task) {
+    Dispatch(num_tasks, [](void* context, int t) {
+      (*static_cast<Task*>(context))(t);
+    }, &task);
+  }
+
+  ~WorkerPool();
+
+ private:
+  typedef void (*TaskFunction)(void* context, int t);
+
+  WorkerPool() {}
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void Dispatch(int num_tasks, TaskFunction function, void* context);
+  // Claims and runs tasks of the current Run until none is left unclaimed.
+  // Called with mutex_ held, which is held again on return.
+  void RunClaimedTasks(std::unique_lock<std::mutex>& lock);
+  void Work();
+
+  std::atomic<bool> busy_{false};  // Set for the whole of a Run
+  std::mutex mutex_;  // Guards the members below
+  std::condition_variable wake_, done_;
+  std::vector<std::thread> threads_;
+  TaskFunction function_ = nullptr;
+  void* context_ = nullptr;
+  int next_task_ = 0, num_tasks_ = 0, pending_ = 0;
+  bool stop_ = false;
+};
+
+#endif  // WORKER_POOL_H_